@@ -0,0 +1,129 @@
+// Measures lexer throughput on generated scripts: regular code and
+// machine-generated code which is mostly whitespace and comments
+//
+// Usage: make bench && ./bin/bench_lexer
+
+#include "lexer/lexer.h"
+#include "lexer/token.h"
+#include "core/memory.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define INPUT_SIZE (16*1024*1024)
+#define ROUNDS     10
+
+// identifiers resembling keywords are the slow path of prefix matching
+static const char *code_lines[] = {
+    "let iffy: real <- 1 + 2.5 * returned;\n",
+    "const elsewhere: str <- \"some string literal\";\n",
+    "func outputs(n: real, reality: bool) -> real {\n",
+    "    return n if notice <= 1 else n * outputs(n - 1, true);\n",
+    "}\n",
+    "-- a comment between the statements\n",
+    "if voidable != false output str boolean;\n",
+    NULL,
+};
+
+static const char *sparse_lines[] = {
+    "-- generated by a tool, do not edit ------------------------------\n",
+    "                                                                  \n",
+    "        let value: real <- 42;        -- the answer to everything\n",
+    "\t\t\t\n",
+    "        output \"a long string literal with many characters in it\";\n",
+    NULL,
+};
+
+static double
+now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec*1000.0 + ts.tv_nsec/1e6;
+}
+
+static Eps_Input *
+generate_input(const char *lines[])
+{
+    Eps_Input *input = EpsMem_Alloc(sizeof(Eps_Input));
+    size_t nlines = 0;
+    size_t len = 0;
+    size_t i = 0;
+
+    while (lines[nlines] != NULL)
+        nlines++;
+
+    input->raw = EpsMem_Alloc(INPUT_SIZE);
+    input->mapped = false;
+    input->fd = -1; // fully buffered
+    input->base = 0;
+    input->consumed = 0;
+    input->lines = NULL;
+    input->line_count = 0;
+    input->line_capacity = 0;
+    input->line_base = 0;
+    input->kept = NULL;
+    input->kept_count = 0;
+    strcpy(input->name, "<bench>");
+
+    for (;;) {
+        size_t line_len = strlen(lines[i % nlines]);
+
+        if (len + line_len > INPUT_SIZE)
+            break;
+
+        memcpy(&input->raw[len], lines[i++ % nlines], line_len);
+        len += line_len;
+    }
+
+    input->len = len;
+
+    return input;
+}
+
+static void
+bench(const char *name, const char *lines[])
+{
+    Eps_Input *input = generate_input(lines);
+    size_t tokens = 0;
+    double t, best = 0;
+    int i;
+
+    for (i = 0; i < ROUNDS; i++) {
+        Eps_TokenBuf *buf;
+
+        t = now_ms();
+        buf = Eps_Lex(input);
+        t = now_ms() - t;
+
+        if (i == 0 || t < best)
+            best = t;
+
+        tokens = buf->length;
+        EpsTokenBuf_Destroy(buf);
+    }
+
+    printf(
+        "%-8s %.1f MB, %zu tokens, best of %d: %.2f ms  %.1f MB/s  %.1f Mtok/s\n",
+        name,
+        input->len/1e6,
+        tokens,
+        ROUNDS,
+        best,
+        input->len/1e3/best,
+        tokens/1e3/best
+    );
+
+    EpsMem_Free(input->lines);
+    EpsMem_Free(input->raw);
+    EpsMem_Free(input);
+}
+
+int main(void) {
+    bench("code", code_lines);
+    bench("sparse", sparse_lines);
+
+    return 0;
+}
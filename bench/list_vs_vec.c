@@ -0,0 +1,150 @@
+// Compares iteration over 1M tokens stored in EpsList, EpsVec
+// and the lexer token buffer
+//
+// Usage: make bench && ./bin/bench_list_vs_vec
+
+#include "lexer/lexer.h"
+#include "lexer/token.h"
+#include "core/ds/list.h"
+#include "core/ds/vec.h"
+#include "core/memory.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define LINE    "let x: real <- 1 + 2;\n" // 9 tokens
+#define TOKENS  1000000
+#define ROUNDS  50
+
+static double
+now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec*1000.0 + ts.tv_nsec/1e6;
+}
+
+static Eps_Input *
+generate_input(void)
+{
+    size_t lines = TOKENS/9 + 1;
+    size_t line_len = strlen(LINE);
+    Eps_Input *input = EpsMem_Alloc(sizeof(Eps_Input));
+    size_t i;
+
+    input->len = lines*line_len;
+    input->raw = EpsMem_Alloc(input->len);
+    input->mapped = false;
+    input->fd = -1; // fully buffered
+    input->base = 0;
+    input->consumed = 0;
+    input->lines = NULL;
+    input->line_count = 0;
+    input->line_capacity = 0;
+    input->line_base = 0;
+    input->kept = NULL;
+    input->kept_count = 0;
+    strcpy(input->name, "<bench>");
+
+    for (i = 0; i < lines; i++) {
+        memcpy(&input->raw[i*line_len], LINE, line_len);
+    }
+
+    return input;
+}
+
+static size_t
+iterate_list(EpsList *list)
+{
+    EpsList_Node *node;
+    size_t sum = 0;
+
+    for (node = list->head; node != NULL; node = node->next) {
+        sum += ((Eps_Token *)node->data)->toktype;
+    }
+
+    return sum;
+}
+
+static size_t
+iterate_vec(EpsVec *vec)
+{
+    size_t sum = 0;
+    size_t i;
+
+    for (i = 0; i < vec->length; i++) {
+        sum += ((Eps_Token *)EpsVec_Get(vec, i))->toktype;
+    }
+
+    return sum;
+}
+
+static size_t
+iterate_buf(Eps_TokenBuf *buf)
+{
+    size_t sum = 0;
+    size_t i;
+
+    for (i = 0; i < buf->length; i++) {
+        sum += buf->items[i].toktype;
+    }
+
+    return sum;
+}
+
+static void
+report(const char *name, double ms, size_t count, size_t sum)
+{
+    printf(
+        "%-12s %8.2f ms  %6.2f ns/token  (checksum %zu)\n",
+        name,
+        ms,
+        ms*1e6/((double)count*ROUNDS),
+        sum
+    );
+}
+
+int main(void) {
+    Eps_Arena *arena = EpsArena_Create();
+    Eps_TokenBuf *buf = Eps_Lex(generate_input());
+    EpsVec *tokens = EpsVec_CreateIn(arena);
+    EpsList *heap_list = EpsList_Create();
+    EpsList *arena_list = EpsList_CreateIn(arena);
+    size_t sum, i;
+    double t;
+
+    for (i = 0; i < buf->length; i++) {
+        EpsVec_Push(tokens, &buf->items[i]);
+        EpsList_Append(heap_list, &buf->items[i]);
+        EpsList_Append(arena_list, &buf->items[i]);
+    }
+
+    printf("%zu tokens, %d rounds\n", tokens->length, ROUNDS);
+
+    sum = 0;
+    t = now_ms();
+    for (i = 0; i < ROUNDS; i++) sum += iterate_list(heap_list);
+    report("EpsList", now_ms() - t, tokens->length, sum);
+
+    sum = 0;
+    t = now_ms();
+    for (i = 0; i < ROUNDS; i++) sum += iterate_list(arena_list);
+    report("EpsList/arena", now_ms() - t, tokens->length, sum);
+
+    sum = 0;
+    t = now_ms();
+    for (i = 0; i < ROUNDS; i++) sum += iterate_vec(tokens);
+    report("EpsVec", now_ms() - t, tokens->length, sum);
+
+    sum = 0;
+    t = now_ms();
+    for (i = 0; i < ROUNDS; i++) sum += iterate_buf(buf);
+    report("Eps_TokenBuf", now_ms() - t, buf->length, sum);
+
+    EpsArena_Destroy(arena);
+    EpsTokenBuf_Destroy(buf);
+
+    return 0;
+}
@@ -5,74 +5,211 @@
 #include <stddef.h>
 #include <string.h>
 #include <stdint.h>
+#include <stdbool.h>
 
-#define INITIAL_CAPACITY 16
-#define EPS_DICT_MAX_LOAD 0.75
+#if defined(__SSE2__) && !defined(EPS_NO_SIMD)
+#   include <emmintrin.h>
+#   define DICT_SSE2
+#endif
 
-#define ADJUCT_CAPACITY(dict) EpsMem_Realloc(dict, dict->capacity*2);
+// Slots are split into groups probed at once. Every slot
+// has a control byte: EMPTY, DELETED, or 7 low bits of
+// the key hash, so most mismatches never touch the slot.
+#define GROUP_WIDTH      16
+#define INITIAL_CAPACITY 16  // power of two, multiple of GROUP_WIDTH
 
-struct eps_dict_item_t {
-    char *key;
-    void *value;
-    struct eps_dict_item_t *next;
+#define CTRL_EMPTY   ((int8_t)-128) // 0b10000000
+#define CTRL_DELETED ((int8_t)-2)   // 0b11111110
 
-    // private
-    size_t _index;
-};
+typedef struct {
+    Eps_Symbol *key;
+    void       *value;
+} Slot;
 
 struct eps_dict_t {
-    EpsDict_Item **items;
-    size_t capacity;
-    size_t length;
+    int8_t *ctrl;      // 'capacity' control bytes
+    Slot   *slots;
+    size_t  capacity;
+    size_t  length;
+    size_t  growth_left; // slots to fill before rehashing
 };
 
-#define FNV_OFFSET 2166136261U
-#define FNV_PRIME 16777619U
+// Upper bits pick the group, lower 7 go to the control byte
+#define H1(hash) ((hash) >> 7)
+#define H2(hash) ((int8_t)((hash) & 0x7f))
+
+// * - Groups -
+
+// Bit i of a mask is set if slot i of the group matches
+typedef uint32_t GroupMask;
+
+#ifdef DICT_SSE2
+
+static GroupMask
+group_match(const int8_t *group, int8_t byte)
+{
+    __m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(byte)));
+}
+
+static GroupMask
+group_match_empty(const int8_t *group)
+{
+    return group_match(group, CTRL_EMPTY);
+}
+
+// EMPTY and DELETED are the only negative control bytes
+static GroupMask
+group_match_free(const int8_t *group)
+{
+    return _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)group));
+}
+
+#else
 
-static uint32_t
-hash_key(char *key)
+static GroupMask
+group_match(const int8_t *group, int8_t byte)
 {
-    uint32_t hash = FNV_OFFSET;
-    for (char *p = key; *p; p++) {
-        hash ^= (uint32_t)(unsigned char)(*p);
-        hash *= FNV_PRIME;
+    GroupMask mask = 0;
+    int i;
+
+    for (i = 0; i < GROUP_WIDTH; i++) {
+        mask |= (GroupMask)(group[i] == byte) << i;
     }
-    return hash;
+
+    return mask;
 }
 
+static GroupMask
+group_match_empty(const int8_t *group)
+{
+    return group_match(group, CTRL_EMPTY);
+}
+
+static GroupMask
+group_match_free(const int8_t *group)
+{
+    GroupMask mask = 0;
+    int i;
+
+    for (i = 0; i < GROUP_WIDTH; i++) {
+        mask |= (GroupMask)(group[i] < 0) << i;
+    }
+
+    return mask;
+}
+
+#endif
+
+// Index of the lowest set bit, mask must not be zero
+static unsigned
+mask_first(GroupMask mask)
+{
+    return __builtin_ctz(mask);
+}
+
+// * - Table -
+
 static size_t
-get_index(size_t capacity, char *key)
+max_load(size_t capacity)
 {
-    return hash_key(key) & (capacity - 1);
+    return capacity - capacity/8;
 }
 
-EpsDict *
-EpsDict_Create(void)
+static void
+init_table(EpsDict *dict, size_t capacity)
 {
-    EpsDict *dict = EpsMem_Alloc(sizeof(EpsDict));
-    dict->length = 0;
-    dict->capacity = INITIAL_CAPACITY;
-    dict->items = EpsMem_Calloc(sizeof(EpsDict_Item), INITIAL_CAPACITY);
+    dict->ctrl = EpsMem_Alloc(capacity);
+    dict->slots = EpsMem_Alloc(sizeof(Slot)*capacity);
+    dict->capacity = capacity;
+    dict->growth_left = max_load(capacity) - dict->length;
 
-    return dict;
+    memset(dict->ctrl, CTRL_EMPTY, capacity);
+}
+
+// Groups are probed quadratically, which visits
+// every group since their count is a power of two
+static size_t
+find_slot(EpsDict *dict, Eps_Symbol *key)
+{
+    uint32_t hash = key->hash;
+    size_t group_mask = dict->capacity/GROUP_WIDTH - 1;
+    size_t group = H1(hash) & group_mask;
+    size_t step;
+
+    for (step = 1; ; step++) {
+        const int8_t *ctrl = &dict->ctrl[group*GROUP_WIDTH];
+        GroupMask match = group_match(ctrl, H2(hash));
+
+        while (match) {
+            size_t i = group*GROUP_WIDTH + mask_first(match);
+
+            if (dict->slots[i].key == key)
+                return i;
+
+            match &= match - 1;
+        }
+
+        // key would have been stored in this group
+        if (group_match_empty(ctrl))
+            return dict->capacity;
+
+        group = (group + step) & group_mask;
+    }
+}
+
+// Returns first EMPTY or DELETED slot on the probe sequence
+static size_t
+find_insert_slot(EpsDict *dict, uint32_t hash)
+{
+    size_t group_mask = dict->capacity/GROUP_WIDTH - 1;
+    size_t group = H1(hash) & group_mask;
+    size_t step;
+
+    for (step = 1; ; step++) {
+        GroupMask free = group_match_free(&dict->ctrl[group*GROUP_WIDTH]);
+
+        if (free)
+            return group*GROUP_WIDTH + mask_first(free);
+
+        group = (group + step) & group_mask;
+    }
 }
 
+// Moves items to a new table, dropping tombstones
 static void
-destroy_dict_items_chain(EpsDict_Item *item, void (*callback)(void *))
+rehash(EpsDict *dict, size_t capacity)
 {
-    EpsDict_Item *next;
-    EpsDict_Item *current = item;
+    int8_t *old_ctrl = dict->ctrl;
+    Slot *old_slots = dict->slots;
+    size_t old_capacity = dict->capacity;
+    size_t i;
+
+    init_table(dict, capacity);
 
-    while (current != NULL) {
-        next = current->next;
+    for (i = 0; i < old_capacity; i++) {
+        if (old_ctrl[i] < 0) continue;
 
-        // destroying the item
-        callback(current->value);
-        EpsMem_Free(current->key);
-        EpsMem_Free(current);
+        size_t j = find_insert_slot(dict, old_slots[i].key->hash);
 
-        current = next;
+        dict->ctrl[j] = old_ctrl[i];
+        dict->slots[j] = old_slots[i];
     }
+
+    EpsMem_Free(old_ctrl);
+    EpsMem_Free(old_slots);
+}
+
+EpsDict *
+EpsDict_Create(void)
+{
+    EpsDict *dict = EpsMem_Alloc(sizeof(EpsDict));
+
+    dict->length = 0;
+    init_table(dict, INITIAL_CAPACITY);
+
+    return dict;
 }
 
 void
@@ -80,58 +217,84 @@ EpsDict_Destroy(EpsDict *dict, void (*callback)(void *))
 {
     size_t i;
 
-    for(i = 0; i < dict->capacity; i++) {
-        destroy_dict_items_chain(dict->items[i], callback);
+    if (callback != NULL) {
+        for (i = 0; i < dict->capacity; i++) {
+            if (dict->ctrl[i] >= 0)
+                callback(dict->slots[i].value);
+        }
     }
 
+    EpsMem_Free(dict->ctrl);
+    EpsMem_Free(dict->slots);
     EpsMem_Free(dict);
 }
 
 void *
-EpsDict_Get(EpsDict *dict, char *key)
+EpsDict_Get(EpsDict *dict, Eps_Symbol *key)
 {
-    EpsDict_Item *current = dict->items[get_index(dict->capacity, key)];
+    size_t i = find_slot(dict, key);
 
-    while (current != NULL && current != NULL) {
-        if(strcmp(current->key, key) == 0) {
-            return current->value;
-        }
-
-        current = current->next;
-    }
-
-    return NULL;
+    return i < dict->capacity ? dict->slots[i].value : NULL;
 }
 
 void
-EpsDict_Set(EpsDict *dict, char *key, void *val)
+EpsDict_Set(EpsDict *dict, Eps_Symbol *key, void *val)
 {
-    EpsDict_Item *item = EpsMem_Alloc(sizeof(EpsDict_Item));
+    uint32_t hash = key->hash;
+    size_t i = find_slot(dict, key);
 
-    if (dict->length + 1 > dict->capacity * EPS_DICT_MAX_LOAD) {
-        ADJUCT_CAPACITY(dict);
+    if (i < dict->capacity) {
+        dict->slots[i].value = val;
+        return;
     }
 
-    item->_index = get_index(dict->capacity, key);
-    item->key = key;
-    item->value = val;
-    item->next = NULL;
+    i = find_insert_slot(dict, hash);
 
-    if (dict->items[item->_index] == NULL) {
-        dict->items[item->_index] = item;
-    } else {
-        EpsDict_Item *current = dict->items[item->_index];
+    // reusing a tombstone doesn't make probe sequences longer
+    if (dict->ctrl[i] == CTRL_EMPTY) {
+        if (dict->growth_left == 0) {
+            // grow unless there are enough tombstones to reclaim
+            size_t capacity = dict->length+1 > max_load(dict->capacity)/2
+                ? dict->capacity*2
+                : dict->capacity;
 
-        while (current->next != NULL) {
-            current = current->next;
+            rehash(dict, capacity);
+            i = find_insert_slot(dict, hash);
         }
 
-        current->next = item;
+        dict->growth_left--;
     }
 
+    dict->ctrl[i] = H2(hash);
+    dict->slots[i].key = key;
+    dict->slots[i].value = val;
     dict->length++;
 }
 
+void *
+EpsDict_Delete(EpsDict *dict, Eps_Symbol *key)
+{
+    size_t i = find_slot(dict, key);
+    void *val;
+
+    if (i == dict->capacity)
+        return NULL;
+
+    val = dict->slots[i].value;
+    dict->length--;
+
+    // probing stops at groups having an EMPTY slot, so if
+    // the group has one, this slot may become EMPTY as well
+    if (group_match_empty(&dict->ctrl[i & ~(size_t)(GROUP_WIDTH-1)])) {
+        dict->ctrl[i] = CTRL_EMPTY;
+        dict->growth_left++;
+    } else {
+        dict->ctrl[i] = CTRL_DELETED;
+    }
+
+    return val;
+}
+
 size_t
 EpsDict_Length(EpsDict *dict)
 {
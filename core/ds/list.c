@@ -3,9 +3,11 @@
 #include <stdio.h>
 
 static EpsList_Node *
-create_node(EpsList_Node *prev, EpsList_Node *next, void *data)
+create_node(EpsList *list, EpsList_Node *prev, EpsList_Node *next, void *data)
 {
-    EpsList_Node *node = EpsMem_Alloc(sizeof(EpsList_Node));
+    EpsList_Node *node = list->arena != NULL
+        ? EpsArena_Alloc(list->arena, sizeof(EpsList_Node))
+        : EpsMem_Alloc(sizeof(EpsList_Node));
 
     node->prev = prev;
     node->next = next;
@@ -20,6 +22,18 @@ EpsList_Create(void)
     EpsList *list = EpsMem_Alloc(sizeof(EpsList));
     list->head = NULL;
     list->last = NULL;
+    list->arena = NULL;
+
+    return list;
+}
+
+EpsList *
+EpsList_CreateIn(Eps_Arena *arena)
+{
+    EpsList *list = EpsArena_Alloc(arena, sizeof(EpsList));
+    list->head = NULL;
+    list->last = NULL;
+    list->arena = arena;
 
     return list;
 }
@@ -45,11 +59,11 @@ EpsList_Append(EpsList *list, void *data)
     EpsList_Node *node;
 
     if (list->head == NULL) {
-        node = create_node(NULL, NULL, data);
+        node = create_node(list, NULL, NULL, data);
         list->head = node;
         list->last = node;
     } else {
-        node = create_node(list->last, NULL, data);
+        node = create_node(list, list->last, NULL, data);
         list->last->next = node;
         list->last = node;
     }
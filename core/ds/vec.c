@@ -0,0 +1,89 @@
+#include "core/ds/vec.h"
+#include "core/memory.h"
+#include <string.h>
+
+#define VEC_MIN_CAPACITY 8
+
+static void
+init_vec(EpsVec *vec, Eps_Arena *arena)
+{
+    vec->items = NULL;
+    vec->length = 0;
+    vec->capacity = 0;
+    vec->arena = arena;
+}
+
+EpsVec *
+EpsVec_Create(void)
+{
+    EpsVec *vec = EpsMem_Alloc(sizeof(EpsVec));
+
+    init_vec(vec, NULL);
+
+    return vec;
+}
+
+EpsVec *
+EpsVec_CreateIn(Eps_Arena *arena)
+{
+    EpsVec *vec = EpsArena_Alloc(arena, sizeof(EpsVec));
+
+    init_vec(vec, arena);
+
+    return vec;
+}
+
+void
+EpsVec_Destroy(EpsVec *vec, void (*callback)(void *data))
+{
+    size_t i;
+
+    if (callback != NULL) {
+        for (i = 0; i < vec->length; i++) {
+            (*callback)(vec->items[i]);
+        }
+    }
+
+    if (vec->arena == NULL) {
+        EpsMem_Free(vec->items);
+        EpsMem_Free(vec);
+    }
+}
+
+static void
+grow(EpsVec *vec)
+{
+    size_t capacity = vec->capacity ? vec->capacity*2 : VEC_MIN_CAPACITY;
+
+    if (vec->arena != NULL) {
+        // arena memory can't be resized, old items are left behind
+        void **items = EpsArena_Alloc(vec->arena, sizeof(void *)*capacity);
+
+        if (vec->length > 0)
+            memcpy(items, vec->items, sizeof(void *)*vec->length);
+
+        vec->items = items;
+    } else {
+        vec->items = EpsMem_Realloc(vec->items, sizeof(void *)*capacity);
+    }
+
+    vec->capacity = capacity;
+}
+
+void
+EpsVec_Push(EpsVec *vec, void *data)
+{
+    if (vec->length == vec->capacity)
+        grow(vec);
+
+    vec->items[vec->length++] = data;
+}
+
+void *
+EpsVec_Pop(EpsVec *vec)
+{
+    if (vec->length == 0)
+        return NULL;
+
+    return vec->items[--vec->length];
+}
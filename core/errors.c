@@ -11,6 +11,7 @@
 #define ERR_INDENT 4
 
 static bool had_error = false;
+static Eps_Input *source = NULL; // input error locations refer to
 
 bool
 EpsErr_WasError(void)
@@ -18,15 +19,22 @@ EpsErr_WasError(void)
     return had_error;
 }
 
+void
+EpsErr_SetSource(Eps_Input *input)
+{
+    source = input;
+}
+
 static void
-print_error(Eps_LexState *ls, const char errname[], const char msg[])
+print_error(Eps_SrcSpan span, Eps_Line line,
+            const char errname[], const char msg[])
 {
     fprintf(
         stderr,
         "%s {%lu:%lu} "RED_STR("%s:")"\n%*s%s\n",
-        ls->fname,
-        ls->line,
-        ls->col,
+        source->name,
+        line.number,
+        span.offset - line.start + 1,
         errname,
         ERR_INDENT,
         "",
@@ -34,51 +42,28 @@ print_error(Eps_LexState *ls, const char errname[], const char msg[])
     );
 }
 
-void
-print_context(Eps_LexState *ls)
+static void
+print_context(Eps_SrcSpan span, Eps_Line line)
 {
     // printing out the line
-	size_t current_line = 1;
-	size_t strsz;
-	size_t start = 0;
-	size_t end;
-	char *line;
-
-	while (current_line < ls->line) {
-		if (ls->input->raw[start++] == '\n') {
-			current_line++;
-		}
-	}
-
-	end = start;
-
-	while (ls->input->raw[end] != '\n' && end < ls->input->len)
-        end++;
-
-
-	strsz = end - start;
-
-	line = EpsMem_Alloc(sizeof(char)*(strsz+1));
-	memcpy(line, &ls->input->raw[start], strsz);
-	line[strsz] = '\0';
-
     printf(
-        "%*s%s\n",
+        "%*s%.*s\n",
         ERR_INDENT,
         "",
-        line
+        (int)line.len,
+        line.text
     );
 
     // printing out underline
-    size_t current = start;
+    size_t current = line.start;
 
     printf("%*s", ERR_INDENT, "");
 
-    while (current++ < ls->start) {
+    while (current++ < span.offset) {
         printf(" ");
     }
 
-    while (current++ < ls->end) {
+    while (current++ < span.offset + span.length) {
         printf(RED_STR("~"));
     }
 
@@ -86,10 +71,14 @@ print_context(Eps_LexState *ls)
 }
 
 void
-EpsErr_Raise(Eps_LexState *ls, const char errname[], const char msg[])
+EpsErr_Raise(Eps_SrcSpan span, const char errname[], const char msg[])
 {
-    print_error(ls, errname, msg);
-    print_context(ls);
+    Eps_Line line = Eps_GetLine(source, span.offset);
+
+    print_error(span, line, errname, msg);
+
+    if (line.text != NULL)
+        print_context(span, line);
 
     had_error = true;
 }
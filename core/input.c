@@ -5,21 +5,173 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #define MAX_LINE_LEN 80
+#define READ_CHUNK_SIZE (64*1024)
 
 static Eps_Input *src; /* source file */
 
-static size_t get_file_len(FILE *f)
+static void
+set_input_name(char *name)
 {
-	fseek(f, 0, SEEK_END);
-	return ftell(f);
+	strcpy(src->name, name);
 }
 
 static void
-set_input_name(char *name)
+init_input(void)
 {
-	strcpy(src->name, name);
+	src->len = 0;
+	src->mapped = false;
+	src->fd = -1;
+	src->base = 0;
+	src->consumed = 0;
+	src->lines = NULL;
+	src->line_count = 0;
+	src->line_capacity = 0;
+	src->line_base = 0;
+	src->kept = NULL;
+	src->kept_count = 0;
+}
+
+/* Index of the last line in the table starting at or before 'offset' */
+static size_t
+line_index(Eps_Input *input, size_t offset)
+{
+	size_t lo = 0;
+	size_t hi = input->line_count;
+
+	while (hi - lo > 1) {
+		size_t mid = lo + (hi - lo)/2;
+
+		if (input->lines[mid] <= offset)
+			lo = mid;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+/* Finds the line among the saved ones */
+static Eps_Line
+kept_line(Eps_Input *input, size_t offset)
+{
+	Eps_Line line = { .number = 0, .start = offset, .text = NULL, .len = 0 };
+	size_t i, pos, start;
+
+	for (i = 0; i < input->kept_count; i++) {
+		Eps_InputText *kept = &input->kept[i];
+
+		if (offset < kept->offset || offset > kept->offset + kept->len)
+			continue;
+
+		line.number = kept->line;
+		start = 0;
+
+		for (pos = 0; pos < offset - kept->offset; pos++) {
+			if (kept->text[pos] == '\n') {
+				line.number++;
+				start = pos + 1;
+			}
+		}
+
+		for (pos = start; pos < kept->len && kept->text[pos] != '\n'; pos++)
+			;
+
+		line.start = kept->offset + start;
+		line.text = &kept->text[start];
+		line.len = pos - start;
+		break;
+	}
+
+	return line;
+}
+
+Eps_Line Eps_GetLine(Eps_Input *input, size_t offset)
+{
+	Eps_Line line;
+	size_t index, end;
+
+	if (offset < input->base)
+		return kept_line(input, offset);
+
+	index = line_index(input, offset);
+	line.number = input->line_base + index + 1;
+	line.start = end = input->lines[index];
+
+	while (end < input->len && input->raw[end - input->base] != '\n')
+		end++;
+
+	line.text = &input->raw[line.start - input->base];
+	line.len = end - line.start;
+
+	return line;
+}
+
+void Eps_KeepInput(Eps_Input *input, size_t from, size_t to)
+{
+	Eps_Line first, last;
+	Eps_InputText *kept;
+
+	if (input->mapped) /* mappings are never discarded */
+		return;
+
+	first = Eps_GetLine(input, from);
+	last = Eps_GetLine(input, to);
+
+	input->kept = EpsMem_Realloc(
+		input->kept,
+		sizeof(Eps_InputText)*(input->kept_count + 1)
+	);
+
+	kept = &input->kept[input->kept_count++];
+	kept->offset = first.start;
+	kept->line = first.number;
+	kept->len = last.start + last.len - first.start;
+	kept->text = EpsMem_Alloc(kept->len);
+	memcpy(kept->text, first.text, kept->len);
+}
+
+void Eps_DiscardInput(Eps_Input *input, size_t offset)
+{
+	if (offset > input->consumed)
+		input->consumed = offset;
+}
+
+/* Drops the lines ending before the consumed offset */
+static void
+slide_input(Eps_Input *input)
+{
+	size_t line, start;
+
+	if (input->line_count == 0)
+		return;
+
+	line = line_index(input, input->consumed);
+	start = input->lines[line];
+
+	if (start <= input->base)
+		return;
+
+	memmove(
+		input->raw,
+		&input->raw[start - input->base],
+		input->len - start
+	);
+	memmove(
+		input->lines,
+		&input->lines[line],
+		sizeof(size_t)*(input->line_count - line)
+	);
+
+	input->base = start;
+	input->line_count -= line;
+	input->line_base += line;
 }
 
 void Eps_StartDialog(void (*callback)(Eps_Input*))
@@ -29,6 +181,7 @@ void Eps_StartDialog(void (*callback)(Eps_Input*))
 	bool is_eof = false;
 
 	set_input_name("stdin");
+	init_input();
 
 	while (!is_eof) {
 		printf(">>> ");
@@ -38,30 +191,121 @@ void Eps_StartDialog(void (*callback)(Eps_Input*))
 	}
 }
 
-Eps_Input *Eps_ReadFile(char* fname)
+/* Maps regular file into memory, pages are read in on demand */
+static bool
+map_file(int fd, size_t len)
 {
-	FILE *f;
-	size_t flen;
-	src = EpsMem_Alloc(sizeof(Eps_Input));
+	void *raw;
 
-	if ((f = fopen(fname, "r")) == NULL) {
-		fprintf(stderr, "cannot open file: %s\n", fname);
+	if (len == 0) /* nothing to map */
+		return false;
+
+	raw = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	if (raw == MAP_FAILED)
+		return false;
+
+	/* the lexer reads the source once, front to back */
+	madvise(raw, len, MADV_SEQUENTIAL);
+
+	src->raw = raw;
+	src->len = len;
+	src->mapped = true;
+
+	return true;
+}
+
+/* Pipes and terminals are read by chunks as the lexer needs them */
+static void
+stream_file(int fd)
+{
+	src->raw = EpsMem_Alloc(READ_CHUNK_SIZE);
+	src->len = 0;
+	src->capacity = READ_CHUNK_SIZE;
+	src->fd = fd;
+}
+
+bool Eps_ReadMore(Eps_Input *input)
+{
+	ssize_t n;
+
+	if (input->fd < 0)
+		return false;
+
+	if (input->len - input->base == input->capacity) {
+		slide_input(input);
+
+		/* grow unless sliding freed a good part of the buffer */
+		if (input->len - input->base > input->capacity/2) {
+			input->capacity *= 2;
+			input->raw = EpsMem_Realloc(input->raw, input->capacity);
+		}
+	}
+
+	do {
+		n = read(
+			input->fd,
+			&input->raw[input->len - input->base],
+			input->capacity - (input->len - input->base)
+		);
+	} while (n < 0 && errno == EINTR);
+
+	if (n < 0) {
+		fprintf(stderr, "cannot read file: %s\n", input->name);
 		exit(1);
 	}
 
-	flen = get_file_len(f);
-	fseek(f, 0, SEEK_SET);
-	src->raw = EpsMem_Alloc(flen);
-	src->len = flen/sizeof(char);
-	set_input_name(fname);
+	if (n == 0) { /* end of stream */
+		if (input->fd != STDIN_FILENO)
+			close(input->fd);
+
+		input->fd = -1;
+		return false;
+	}
+
+	input->len += n;
+	return true;
+}
+
+Eps_Input *Eps_ReadFile(char* fname)
+{
+	struct stat st;
+	bool is_stdin = strcmp(fname, "-") == 0;
+	int fd = is_stdin ? STDIN_FILENO : open(fname, O_RDONLY);
+
+	src = EpsMem_Alloc(sizeof(Eps_Input));
+	init_input();
+	set_input_name(is_stdin ? "stdin" : fname);
 
-	if (src->raw != NULL) {
-		fread(src->raw, 1, flen, f);
-	} else {
-		fprintf(stderr, "file source malloc failed\n");
+	if (fd < 0 || fstat(fd, &st) != 0) {
+		fprintf(stderr, "cannot open file: %s\n", fname);
 		exit(1);
 	}
 
-	fclose(f);
+	if (!S_ISREG(st.st_mode) || !map_file(fd, st.st_size))
+		stream_file(fd);
+	else if (!is_stdin)
+		close(fd);
+
 	return src;
 }
+
+void Eps_CloseFile(Eps_Input *input)
+{
+	size_t i;
+
+	if (input->mapped)
+		munmap(input->raw, input->len);
+	else
+		EpsMem_Free(input->raw);
+
+	if (input->fd > STDIN_FILENO)
+		close(input->fd);
+
+	for (i = 0; i < input->kept_count; i++)
+		EpsMem_Free(input->kept[i].text);
+
+	EpsMem_Free(input->kept);
+	EpsMem_Free(input->lines);
+	EpsMem_Free(input);
+}
@@ -2,6 +2,18 @@
 #include "core/errors.h"
 #include <stdlib.h>
 
+#define ARENA_BLOCK_SIZE (64*1024)
+#define ARENA_ALIGN      (sizeof(max_align_t))
+
+struct Eps_ArenaBlock {
+    Eps_ArenaBlock *prev;
+    size_t          used;
+    size_t          size;
+    max_align_t     data[];
+};
+
+static size_t alloc_count = 0;
+
 Eps_Mem*
 EpsMem_Alloc(size_t size)
 {
@@ -11,6 +23,8 @@ EpsMem_Alloc(size_t size)
         EpsErr_Fatal("memory allocation failed");
     }
 
+    alloc_count++;
+
     return memptr;
 }
 
@@ -23,6 +37,8 @@ EpsMem_Calloc(size_t size, size_t n)
         EpsErr_Fatal("memory allocation failed");
     }
 
+    alloc_count++;
+
     return memptr;
 }
 
@@ -35,6 +51,8 @@ EpsMem_Realloc(Eps_Mem* mem, size_t size)
         EpsErr_Fatal("memory reallocation failed");
     }
 
+    alloc_count++;
+
     return newmem;
 }
 
@@ -43,3 +61,75 @@ EpsMem_Free(Eps_Mem* mem)
 {
     free(mem);
 }
+
+size_t
+EpsMem_AllocCount(void)
+{
+    return alloc_count;
+}
+
+// * - Arena -
+
+static Eps_ArenaBlock *
+arena_block_create(Eps_ArenaBlock *prev, size_t size)
+{
+    Eps_ArenaBlock *block = EpsMem_Alloc(sizeof(Eps_ArenaBlock) + size);
+
+    block->prev = prev;
+    block->used = 0;
+    block->size = size;
+
+    return block;
+}
+
+Eps_Arena *
+EpsArena_Create(void)
+{
+    Eps_Arena *arena = EpsMem_Alloc(sizeof(Eps_Arena));
+
+    arena->blocks = arena_block_create(NULL, ARENA_BLOCK_SIZE);
+
+    return arena;
+}
+
+Eps_Mem *
+EpsArena_Alloc(Eps_Arena *arena, size_t size)
+{
+    Eps_ArenaBlock *block = arena->blocks;
+    Eps_Mem *memptr;
+
+    size = (size + ARENA_ALIGN-1) & ~(ARENA_ALIGN-1);
+
+    if (block->used + size > block->size) {
+        if (size > ARENA_BLOCK_SIZE/4) {
+            // oversized requests get their own block behind
+            // the current one, so its free space isn't wasted
+            block->prev = arena_block_create(block->prev, size);
+            block->prev->used = size;
+
+            return block->prev->data;
+        }
+
+        block = arena->blocks = arena_block_create(block, ARENA_BLOCK_SIZE);
+    }
+
+    memptr = (char *)block->data + block->used;
+    block->used += size;
+
+    return memptr;
+}
+
+void
+EpsArena_Destroy(Eps_Arena *arena)
+{
+    Eps_ArenaBlock *block = arena->blocks;
+
+    while (block != NULL) {
+        Eps_ArenaBlock *prev = block->prev;
+
+        EpsMem_Free(block);
+        block = prev;
+    }
+
+    EpsMem_Free(arena);
+}
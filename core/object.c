@@ -1,5 +1,6 @@
 #include "core/object.h"
 #include "core/memory.h"
+#include "core/symbol.h"
 #include <string.h>
 #include <stdio.h>
 
@@ -7,47 +8,136 @@ static const char * obj_strings[] = {
     "real",
     "string",
     "bool",
-    "void"
+    "void",
+    "function",
+    "undefined",
+    "any"
 };
 
-Eps_Object *
-EpsObject_Create(Eps_ObjectType type, void *val, bool mut)
+Eps_Object
+EpsObject_Real(double val)
 {
-    Eps_Object *obj = EpsMem_Alloc(sizeof(obj));
-    obj->type = type;
-    obj->value = val;
-    obj->mut = mut;
+    Eps_Object obj = { .type = OBJ_REAL, .real = val };
 
     return obj;
 }
 
-Eps_Object *
-EpsObject_Clone(Eps_Object *obj)
+Eps_Object
+EpsObject_Bool(bool val)
 {
-    void *val = NULL;
+    Eps_Object obj = { .type = OBJ_BOOL, .boolean = val };
 
-    switch (obj->type) {
-        case OBJ_REAL:
-        {
-            val = EpsMem_Alloc(sizeof(double));
-            *(double *)val = *(double *)obj->value;
-        } break;
-        case OBJ_STRING:
-        {
-            val = EpsMem_Alloc(sizeof(char)*strlen(obj->value));
-            strcpy(val, obj->value);
-        } break;
-        default: break;
-    }
+    return obj;
+}
+
+static Eps_String *
+string_alloc(uint32_t capacity)
+{
+    Eps_String *string = EpsMem_Alloc(sizeof(Eps_String) + capacity + 1);
+
+    string->refs = 1;
+    string->hash = 0;
+    string->length = 0;
+    string->capacity = capacity;
+
+    return string;
+}
+
+Eps_String *
+EpsString_Create(const char *str, size_t len)
+{
+    Eps_String *string = string_alloc(len);
+
+    string->length = len;
+    memcpy(string->chars, str, len);
+    string->chars[len] = '\0';
+
+    return string;
+}
+
+uint32_t
+EpsString_Hash(Eps_String *str)
+{
+    // strings hashing to 0 are just hashed every time
+    if (str->hash == 0)
+        str->hash = EpsSymbol_Hash(str->chars, str->length);
+
+    return str->hash;
+}
+
+bool
+EpsString_Equal(Eps_String *a, Eps_String *b)
+{
+    // hashes are compared only if both are known, computing
+    // them would read the strings anyway
+    return a == b || (
+        a->length == b->length
+        && (a->hash == 0 || b->hash == 0 || a->hash == b->hash)
+        && memcmp(a->chars, b->chars, a->length) == 0
+    );
+}
+
+Eps_Object
+EpsObject_String(Eps_String *str)
+{
+    Eps_Object obj = { .type = OBJ_STRING, .string = str };
+
+    return obj;
+}
+
+Eps_Object
+EpsObject_Void(void)
+{
+    Eps_Object obj = { .type = OBJ_VOID, .string = NULL };
 
-    return EpsObject_Create(obj->type, val, obj->mut);
+    return obj;
+}
+
+Eps_Object
+EpsObject_Clone(Eps_Object obj)
+{
+    if (obj.type == OBJ_STRING)
+        obj.string->refs++;
+
+    return obj;
 }
 
 void
 EpsObject_Destroy(Eps_Object *obj)
 {
-    EpsMem_Free(obj->value);
-    EpsMem_Free(obj);
+    if (obj->type == OBJ_STRING && --obj->string->refs == 0)
+        EpsMem_Free(obj->string);
+
+    obj->type = OBJ_VOID;
+}
+
+Eps_Object
+EpsObject_Concat(Eps_Object left, Eps_Object right)
+{
+    uint32_t llen = left.string->length;
+    uint32_t length = llen + right.string->length;
+    Eps_String *res = left.string;
+
+    if (res->refs == 1) {
+        // nobody else sees the string, so it is safe to modify,
+        // capacity is doubled to make repeated appends cheap
+        if (length > res->capacity) {
+            res->capacity = length > 2*res->capacity ? length : 2*res->capacity;
+            res = EpsMem_Realloc(res, sizeof(Eps_String) + res->capacity + 1);
+        }
+
+        res->hash = 0;
+    } else {
+        res = string_alloc(length);
+        memcpy(res->chars, left.string->chars, llen);
+        EpsObject_Destroy(&left);
+    }
+
+    res->length = length;
+    memcpy(res->chars + llen, right.string->chars, right.string->length + 1);
+    EpsObject_Destroy(&right);
+
+    return EpsObject_String(res);
 }
 
 const char *
@@ -56,39 +146,36 @@ EpsDbg_GetObjectTypeString(Eps_ObjectType obj_type)
     return obj_strings[obj_type];
 }
 
-static Eps_Object *
-bool_to_string(Eps_Object *obj)
+static Eps_Object
+bool_to_string(Eps_Object obj)
 {
-    return EpsObject_Create(
-        OBJ_STRING,
-        strdup(*(bool *)obj->value ? "true": "false"),
-        obj->mut
-    );
+    const char *str = obj.boolean ? "true": "false";
+
+    return EpsObject_String(EpsString_Create(str, strlen(str)));
 }
 
-static Eps_Object *
-real_to_string(Eps_Object *obj)
+static Eps_Object
+real_to_string(Eps_Object obj)
 {
-    size_t len;
-    char *str;
+    int len = snprintf(NULL, 0, "%g", obj.real);
+    Eps_String *str = string_alloc(len);
 
-    len = (size_t)snprintf(NULL, 0, "%f", *(double *)obj->value) + 1;
-    str = EpsMem_Alloc(len);
-    snprintf(str, len, "%g", *(double *)obj->value);
+    str->length = len;
+    snprintf(str->chars, len + 1, "%g", obj.real);
 
-    return EpsObject_Create(OBJ_STRING, str, obj->mut);
+    return EpsObject_String(str);
 }
 
-Eps_Object *
-EpsObject_ToString(Eps_Object *obj)
+Eps_Object
+EpsObject_ToString(Eps_Object obj)
 {
-    switch (obj->type) {
+    switch (obj.type) {
         case OBJ_REAL:
             return real_to_string(obj);
         case OBJ_BOOL:
             return bool_to_string(obj);
-        case OBJ_STRING: // nothing to do, just clone
+        case OBJ_STRING: // nothing to do, just share
             return EpsObject_Clone(obj);
-        default: return NULL;
+        default: return EpsObject_Void();
     }
 }
@@ -0,0 +1,113 @@
+#include "core/symbol.h"
+#include "core/memory.h"
+#include <string.h>
+#include <stdbool.h>
+
+#define INITIAL_CAPACITY 256 // power of two
+
+#define FNV_OFFSET 2166136261U
+#define FNV_PRIME 16777619U
+
+// Symbol table, open addressing with linear probing
+static struct {
+    Eps_Symbol **items;
+    size_t       capacity;
+    size_t       length;
+    Eps_Arena   *arena; // symbols are allocated from it
+} table;
+
+uint32_t
+EpsSymbol_Hash(const char *str, size_t length)
+{
+    uint32_t hash = FNV_OFFSET;
+    size_t i;
+
+    for (i = 0; i < length; i++) {
+        hash ^= (uint32_t)(unsigned char)str[i];
+        hash *= FNV_PRIME;
+    }
+
+    return hash;
+}
+
+static bool
+symbol_equals(Eps_Symbol *sym, const char *str, size_t length, uint32_t hash)
+{
+    return sym->hash == hash
+        && sym->length == length
+        && memcmp(sym->str, str, length) == 0;
+}
+
+static void
+table_insert(Eps_Symbol *sym)
+{
+    size_t mask = table.capacity - 1;
+    size_t i = sym->hash & mask;
+
+    while (table.items[i] != NULL) {
+        i = (i + 1) & mask;
+    }
+
+    table.items[i] = sym;
+}
+
+static void
+table_grow(void)
+{
+    Eps_Symbol **old_items = table.items;
+    size_t old_capacity = table.capacity;
+    size_t i;
+
+    table.capacity = old_capacity ? old_capacity*2 : INITIAL_CAPACITY;
+    table.items = EpsMem_Calloc(sizeof(Eps_Symbol *), table.capacity);
+
+    for (i = 0; i < old_capacity; i++) {
+        if (old_items[i] != NULL)
+            table_insert(old_items[i]);
+    }
+
+    EpsMem_Free(old_items);
+}
+
+Eps_Symbol *
+EpsSymbol_Intern(const char *str, size_t length)
+{
+    uint32_t hash = EpsSymbol_Hash(str, length);
+    Eps_Symbol *sym;
+    size_t mask, i;
+
+    if (table.length+1 > table.capacity/2) {
+        if (table.arena == NULL)
+            table.arena = EpsArena_Create();
+
+        table_grow();
+    }
+
+    mask = table.capacity - 1;
+
+    for (i = hash & mask; table.items[i] != NULL; i = (i + 1) & mask) {
+        if (symbol_equals(table.items[i], str, length, hash))
+            return table.items[i];
+    }
+
+    sym = EpsArena_Alloc(table.arena, sizeof(Eps_Symbol) + length + 1);
+    sym->hash = hash;
+    sym->length = length;
+    memcpy(sym->str, str, length);
+    sym->str[length] = '\0';
+
+    table.items[i] = sym;
+    table.length++;
+
+    return sym;
+}
+
+void
+EpsSymbol_FreeAll(void)
+{
+    if (table.arena != NULL)
+        EpsArena_Destroy(table.arena);
+
+    EpsMem_Free(table.items);
+    memset(&table, 0, sizeof(table));
+}
@@ -1,18 +1,68 @@
 #include "interpreter/interpret.h"
+#include "interpreter/resolver.h"
+#include "interpreter/typechecker.h"
+#include "vm/compiler.h"
+#include "vm/vm.h"
 #include "parser.h"
+#include "optimizer.h"
 #include "lexer/lexer.h"
 #include "core/ds/dict.h"
-#include "core/ds/list.h"
 #include "core/errors.h"
 #include "core/memory.h"
+#include "core/symbol.h"
 #include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
 #include <sys/time.h>
 
+// Calls may be nested this deep unless --max-depth is passed
+#define DEFAULT_MAX_DEPTH (1 << 20)
+
 int main(int argc, char *argv[]) {
-    if (argc < 2) {
+    char *fname = NULL;
+    bool use_vm = false;
+    bool stream = false;
+    bool alloc_stats = false;
+    bool dump_ast = false;
+    size_t max_depth = DEFAULT_MAX_DEPTH;
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--vm") == 0) {
+            use_vm = true;
+        } else if (strcmp(argv[i], "--stream") == 0) {
+            stream = true;
+        } else if (strcmp(argv[i], "--dump-ast") == 0) {
+            dump_ast = true;
+        } else if (strcmp(argv[i], "--alloc-stats") == 0) {
+            alloc_stats = true;
+        } else if (strcmp(argv[i], "--max-depth") == 0) {
+            char *end = NULL;
+
+            if (i + 1 < argc)
+                max_depth = strtoul(argv[++i], &end, 10);
+
+            if (end == NULL || *end != '\0' || max_depth == 0) {
+                EpsErr_Fatal("--max-depth expects a positive number");
+            }
+        } else {
+            fname = argv[i];
+        }
+    }
+
+    if (fname == NULL) {
         EpsErr_Fatal("no input file provided");
     }
 
+    if (use_vm && stream) {
+        EpsErr_Fatal("--stream is not supported by the vm");
+    }
+
+    if (dump_ast && stream) {
+        EpsErr_Fatal("--dump-ast is not supported in stream mode");
+    }
+
 #ifdef EPS_DBG
     struct timeval t1, t2;
     double elapsedTime;
@@ -20,11 +70,56 @@ int main(int argc, char *argv[]) {
     gettimeofday(&t1, NULL);
 #endif
 
-    Eps_Input *input = Eps_ReadFile(argv[1]);
-    EpsList *toks = Eps_Lex(input);
-    EpsList *stmts = Eps_Parse(toks);
+    Eps_Input *input = Eps_ReadFile(fname);
+
+    if (stream) {
+        Eps_Parser *parser = EpsParser_Create(input);
+
+        Eps_InterpretStream(parser, max_depth);
+        EpsParser_Destroy(parser);
+    } else {
+        Eps_TokenBuf *toks = Eps_Lex(input);
+        Eps_Ast *ast = Eps_Parse(input, toks);
 
-    Eps_Interpret(stmts);
+        // AST does not refer to the tokens
+        EpsTokenBuf_Destroy(toks);
+
+        if (!EpsErr_WasError())
+            Eps_Optimize(ast);
+
+        if (dump_ast) {
+            EpsAst_Dump(ast, stdout);
+        } else if (use_vm) {
+            Eps_Program *program = NULL;
+
+            // the compiler relies on the names and types being
+            // checked the same way as the interpreter does
+            Eps_Resolve(ast);
+
+            if (!EpsErr_WasError())
+                Eps_TypeCheck(ast);
+
+            if (!EpsErr_WasError())
+                program = Eps_Compile(ast);
+
+            if (program != NULL) {
+                EpsVm_Run(program, max_depth);
+                EpsProgram_Destroy(program);
+            }
+        } else {
+            Eps_Interpret(ast, max_depth);
+        }
+
+        // AST is not needed anymore
+        EpsAst_Destroy(ast);
+    }
+
+    EpsSymbol_FreeAll();
+    Eps_CloseFile(input);
+
+    if (alloc_stats) {
+        fprintf(stderr, "heap allocations: %zu\n", EpsMem_AllocCount());
+    }
 
 #ifdef EPS_DBG
     gettimeofday(&t2, NULL);
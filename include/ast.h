@@ -2,13 +2,22 @@
 #   define EPS_AST
 
 #include "lexer/token.h"
-#include "core/ds/list.h"
 #include "core/object.h"
+#include "core/symbol.h"
+#include <stdint.h>
+
+// Nodes live in the pools of the Eps_Ast and refer
+// to each other by their 32-bit index in the pool
+typedef uint32_t Eps_AstIndex;
+
+#define EPS_AST_NONE ((Eps_AstIndex)-1) // absent node
+
+// Run of indices in the list pool of the Eps_Ast
+typedef struct {
+    Eps_AstIndex start;
+    uint32_t     length;
+} Eps_AstList;
 
-typedef struct Eps_AstPrimaryNode Eps_AstPrimaryNode;
-typedef struct Eps_AstUnaryNode Eps_AstUnaryNode;
-typedef struct Eps_AstBinNode Eps_AstBinNode;
-typedef struct Eps_AstTernaryNode Eps_AstTernaryNode;
 typedef struct Eps_AstNode Eps_AstNode;
 
 typedef enum {
@@ -18,58 +27,85 @@ typedef enum {
     NODE_PRIMARY,
 } Eps_AstNodeType;
 
-struct Eps_AstNode {
-    Eps_AstNodeType type;
-    Eps_LexState ls;
-
-    union {
-        Eps_AstPrimaryNode *primary;
-        Eps_AstUnaryNode   *unary;
-        Eps_AstBinNode     *binary;
-        Eps_AstTernaryNode *ternary;
-    };
+typedef enum {
+    PRIMARY_LIT = 0,
+    PRIMARY_PAREN,
+    PRIMARY_CALL,
+    PRIMARY_ID
+} Eps_AstPrimaryType;
 
-#ifdef EPS_DBG
-    char *debug_string;
-#endif
-};
+// Identifier materialized by the parser
+typedef struct {
+    Eps_Symbol  *name; // interned lexeme
+    Eps_SrcSpan  span;
+} Eps_Identifier;
 
 typedef struct Eps_Call {
-    Eps_Token *identifier;
-    EpsList   *args;
+    Eps_Identifier identifier;
+    Eps_AstList    args;  // argument expressions
+    uint32_t       depth; // scopes between the call and the callee binding
+    uint32_t       slot;  // callee binding slot
+    Eps_AstIndex   func;  // statement of the callee, EPS_AST_NONE
+                          // if the callee is looked up at runtime
+    bool           checked; // arity and argument types are checked statically
 } Eps_Call;
 
-struct Eps_AstPrimaryNode {
-    enum {
-        PRIMARY_LIT = 0,
-        PRIMARY_PAREN,
-        PRIMARY_CALL,
-        PRIMARY_ID
-    } type;
+// Specialized variants binary nodes are rewritten into
+// by the interpreter when they are evaluated first time
+typedef enum {
+    QUICK_NONE = 0,  // not evaluated yet
+    QUICK_GENERIC,   // operand types vary, no specialization
+    QUICK_ADD_REAL_REAL,
+    QUICK_SUB_REAL_REAL,
+    QUICK_MUL_REAL_REAL,
+    QUICK_DIV_REAL_REAL,
+    QUICK_EQUAL_REAL_REAL,
+    QUICK_NOT_EQUAL_REAL_REAL,
+    QUICK_LESS_REAL_REAL,
+    QUICK_LESS_EQUAL_REAL_REAL,
+    QUICK_GREATER_REAL_REAL,
+    QUICK_GREATER_EQUAL_REAL_REAL,
+    QUICK_CONCAT_STR_STR,
+} Eps_AstQuickType;
+
+struct Eps_AstNode {
+    uint8_t     type;     // Eps_AstNodeType
+    uint8_t     primary;  // Eps_AstPrimaryType of the primary nodes
+    uint8_t     operator; // Eps_TokenType of the unary and binary nodes
+    uint8_t     value_type; // Eps_ObjectType the node evaluates to,
+                            // OBJ_ANY unless the type checker knows it
+    uint8_t     quick;    // Eps_AstQuickType of the binary nodes
+    Eps_SrcSpan span;     // node token, whole expressions span
+                          // one line of their source
 
     union {
-        Eps_Call    *func;       // function call
-        Eps_Token   *identifier; // variable
-        Eps_Object  *literal;    // literal value
-        Eps_AstNode *expr;       // for parenthesized expressions
+        struct {
+            Eps_AstIndex cond;
+            Eps_AstIndex left;
+            Eps_AstIndex right;
+        } ternary;
+        struct {
+            Eps_AstIndex left;
+            Eps_AstIndex right;
+            Eps_SrcSpan  op_span;
+        } binary;
+        struct {
+            Eps_AstIndex right;
+            Eps_SrcSpan  op_span;
+        } unary;
+        Eps_Object   literal; // literal value
+        Eps_AstIndex expr;    // for parenthesized expressions
+        Eps_AstIndex call;    // function call in the call pool
+        struct {              // variable, bound by the resolver
+            Eps_Symbol *name;
+            uint32_t    depth;
+            uint32_t    slot;
+        } var;
     };
-};
-
-struct Eps_AstUnaryNode {
-    Eps_AstNode *right;
-    Eps_Token   *operator;
-};
 
-struct Eps_AstBinNode {
-    Eps_AstNode *left;
-    Eps_AstNode *right;
-    Eps_Token   *operator;
-};
-
-struct Eps_AstTernaryNode {
-    Eps_AstNode *cond;
-    Eps_AstNode *left;
-    Eps_AstNode *right;
+#ifdef EPS_DBG
+    char *debug_string;
+#endif
 };
 
 #endif
@@ -1,22 +1,31 @@
 #ifndef EPS_DICT
 #   define EPS_DICT
 
+#include "core/symbol.h"
 #include <stddef.h>
 
-typedef struct eps_dict_item_t EpsDict_Item;
+// Open addressing hash table keyed by interned symbols,
+// keys are compared by pointer
 typedef struct eps_dict_t EpsDict;
 
 EpsDict *
 EpsDict_Create(void);
 
+// Destroys the dict, calling 'callback' (if any) on every value
 void
 EpsDict_Destroy(EpsDict *dict, void (*callback)(void *));
 
+// Returns value stored by 'key' or NULL
 void *
-EpsDict_Get(EpsDict *dict, char *key);
+EpsDict_Get(EpsDict *dict, Eps_Symbol *key);
 
+// Stores 'val' by 'key', replacing previous value if any
 void
-EpsDict_Set(EpsDict *dict, char *key, void *val);
+EpsDict_Set(EpsDict *dict, Eps_Symbol *key, void *val);
+
+// Removes 'key', returns the value it held or NULL
+void *
+EpsDict_Delete(EpsDict *dict, Eps_Symbol *key);
 
 size_t
 EpsDict_Length(EpsDict *dict);
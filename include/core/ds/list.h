@@ -1,6 +1,8 @@
 #ifndef EPS_LIST
 #   define EPS_LIST
 
+#include "core/memory.h"
+
 typedef struct node {
     void *data;
     struct node *prev;
@@ -10,11 +12,17 @@ typedef struct node {
 typedef struct list {
     EpsList_Node *head;
     EpsList_Node *last;
+    Eps_Arena    *arena; // where nodes are allocated, NULL for heap
 } EpsList;
 
 EpsList *
 EpsList_Create(void);
 
+// Creates list living in the 'arena' along with its nodes,
+// it is released with the arena
+EpsList *
+EpsList_CreateIn(Eps_Arena *arena);
+
 void
 EpsList_Destroy(EpsList *list, void (*callback)(void *data));
 
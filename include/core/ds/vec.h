@@ -0,0 +1,40 @@
+#ifndef EPS_VEC
+#   define EPS_VEC
+
+#include "core/memory.h"
+#include <stddef.h>
+
+// Growable array of pointers, items are stored contiguously
+// and may be accessed directly by index
+typedef struct {
+    void      **items;
+    size_t      length;
+    size_t      capacity;
+    Eps_Arena  *arena; // where items are allocated, NULL for heap
+} EpsVec;
+
+EpsVec *
+EpsVec_Create(void);
+
+// Creates vector living in the 'arena' along with its items,
+// it is released with the arena
+EpsVec *
+EpsVec_CreateIn(Eps_Arena *arena);
+
+void
+EpsVec_Destroy(EpsVec *vec, void (*callback)(void *data));
+
+void
+EpsVec_Push(EpsVec *vec, void *data);
+
+void *
+EpsVec_Pop(EpsVec *vec);
+
+// Returns item at 'index', index must be in bounds
+static inline void *
+EpsVec_Get(const EpsVec *vec, size_t index)
+{
+    return vec->items[index];
+}
+
+#endif
@@ -15,8 +15,12 @@
         va_end (arg); \
     } \
 
+// Sets the input error locations refer to
 void
-EpsErr_Raise(Eps_LexState *ls, const char errname[], const char msg[]);
+EpsErr_SetSource(Eps_Input *input);
+
+void
+EpsErr_Raise(Eps_SrcSpan span, const char errname[], const char msg[]);
 
 bool
 EpsErr_WasError(void);
@@ -1,17 +1,81 @@
 #ifndef INPUT_H
 #define INPUT_H
 #include <stddef.h> /* size_t */
+#include <stdint.h>
+#include <stdbool.h>
 
 #define MAX_FNAME_LEN 255
 
 typedef struct {
-    char *raw;
+    size_t offset;        /* offset of the first line */
+    size_t line;          /* number of the first line */
+    size_t len;
+    char *text;
+} Eps_InputText;
+
+typedef struct {
+    char *raw;            /* input from offset 'base' to 'len' */
     size_t len;
     char name[MAX_FNAME_LEN];
+    bool mapped;          /* raw is a read-only file mapping */
+    int fd;               /* stream being read, -1 once raw is complete */
+    size_t capacity;      /* size of the stream buffer */
+    size_t base;          /* offset of raw[0], earlier bytes are discarded */
+    size_t consumed;      /* lines before this offset may be discarded */
+    size_t *lines;        /* offsets of line starts, built by the lexer */
+    size_t line_count;
+    size_t line_capacity;
+    size_t line_base;     /* number of lines discarded before 'lines' */
+    Eps_InputText *kept;  /* discarded lines still referred to */
+    size_t kept_count;
 } Eps_Input;
 
+/* Source line, 'text' is NULL if the line is discarded */
+typedef struct {
+    size_t number;        /* starting from 1 */
+    size_t start;         /* offset of the first char */
+    const char *text;
+    size_t len;           /* not including the newline */
+} Eps_Line;
+
+/**
+ * Opens source file, "-" stands for stdin.
+ * Regular files are memory-mapped, pipes and
+ * terminals are read on demand by Eps_ReadMore.
+ */
 Eps_Input *Eps_ReadFile(char *fname);
 
+/**
+ * Appends next chunk of the stream to raw, which may
+ * move it. Returns false at the end of input.
+ * Consumed lines are slid out of a full buffer
+ * before it grows.
+ */
+bool Eps_ReadMore(Eps_Input *input);
+
+/**
+ * Marks input before 'offset' as consumed, so
+ * Eps_ReadMore may discard the lines it ends.
+ */
+void Eps_DiscardInput(Eps_Input *input, size_t offset);
+
+/**
+ * Saves lines of range from 'from' to 'to' for
+ * error messages after the input is discarded.
+ */
+void Eps_KeepInput(Eps_Input *input, size_t from, size_t to);
+
+/**
+ * Releases the input and its line index.
+ */
+void Eps_CloseFile(Eps_Input *input);
+
+/**
+ * Returns the line containing byte 'offset'.
+ * Works after the input is lexed.
+ */
+Eps_Line Eps_GetLine(Eps_Input *input, size_t offset);
+
 /**
  * Starts dialog mode, all IO API
  * works the same.
@@ -1,8 +1,7 @@
 #ifndef EPS_MEMORY
 #define EPS_MEMORY
 
-#include "errors.h"
-#include "stddef.h"
+#include <stddef.h>
 
 typedef void Eps_Mem;
 
@@ -29,4 +28,32 @@ void EpsMem_Free(Eps_Mem* mem);
 
 size_t Eps_MemUsage(void);
 
+/**
+ * Returns number of heap (re)allocations made so far.
+ */
+size_t EpsMem_AllocCount(void);
+
+typedef struct Eps_ArenaBlock Eps_ArenaBlock;
+
+/**
+ * Region allocator. Memory is carved out of large
+ * blocks and released all at once on destroy.
+ */
+typedef struct {
+    Eps_ArenaBlock *blocks;
+} Eps_Arena;
+
+Eps_Arena *EpsArena_Create(void);
+
+/**
+ * Allocates aligned memory from the arena,
+ * there is no way to free it individually.
+ */
+Eps_Mem *EpsArena_Alloc(Eps_Arena *arena, size_t size);
+
+/**
+ * Frees up the arena and everything allocated from it.
+ */
+void EpsArena_Destroy(Eps_Arena *arena);
+
 #endif
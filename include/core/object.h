@@ -2,35 +2,86 @@
 #   define EPS_OBJECT
 
 #include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
 
 typedef enum {
     OBJ_REAL,
     OBJ_STRING,
     OBJ_BOOL,
     OBJ_VOID,
+
+    // Internal types, expressions never evaluate to them
+    OBJ_FUNC,      // function declaration bound to a scope slot
+    OBJ_UNDEFINED, // scope slot which is not defined yet
+    OBJ_ANY,       // static type of expressions checked at runtime
 } Eps_ObjectType;
 
+// Strings are shared between the objects holding them,
+// the payload is copied only to modify a shared string
+typedef struct {
+    uint32_t refs;
+    uint32_t hash;     // 0 until computed
+    uint32_t length;
+    uint32_t capacity; // chars fitting the allocation, without the null
+    char     chars[];  // null-terminated, stored right after the header
+} Eps_String;
+
+// Objects are passed by value, only strings own heap memory
 typedef struct {
     Eps_ObjectType type;
-    void *value;
-    bool mut;
+
+    union {
+        double  real;
+        bool    boolean;
+        Eps_String *string;
+        uint32_t    func; // index of the declaring statement in the AST
+    };
 } Eps_Object;
 
-Eps_Object *
-EpsObject_Create(Eps_ObjectType type, void *val, bool mut);
+Eps_Object
+EpsObject_Real(double val);
+
+Eps_Object
+EpsObject_Bool(bool val);
+
+// Copies 'len' characters of 'str' into a new string
+Eps_String *
+EpsString_Create(const char *str, size_t len);
 
-Eps_Object *
-EpsObject_Clone(Eps_Object *obj);
+// Returns hash of the string, computing it on first use
+uint32_t
+EpsString_Hash(Eps_String *str);
+
+bool
+EpsString_Equal(Eps_String *a, Eps_String *b);
+
+// Note: takes ownership of the reference to 'str'
+Eps_Object
+EpsObject_String(Eps_String *str);
+
+Eps_Object
+EpsObject_Void(void);
+
+// Returns new reference to the object, strings are shared
+Eps_Object
+EpsObject_Clone(Eps_Object obj);
 
 const char *
 EpsDbg_GetObjectTypeString(Eps_ObjectType obj_type);
 
+// Drops the object reference, releasing memory it was the last owner of
 void
 EpsObject_Destroy(Eps_Object *obj);
 
+// Concatenates strings, consuming both references. Appends
+// to 'left' in place when nothing else refers to it.
+Eps_Object
+EpsObject_Concat(Eps_Object left, Eps_Object right);
+
 // Converts object to string.
-// Note: if OBJ_STRING passed, returns clone of this object.
-Eps_Object *
-EpsObject_ToString(Eps_Object *obj);
+// Note: if OBJ_STRING passed, returns new reference to this object.
+Eps_Object
+EpsObject_ToString(Eps_Object obj);
 
 #endif
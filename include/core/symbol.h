@@ -0,0 +1,27 @@
+#ifndef EPS_SYMBOL
+#   define EPS_SYMBOL
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Interned name, there is exactly one symbol per distinct
+// string, so symbols are compared by pointer
+typedef struct {
+    uint32_t hash;
+    uint32_t length;
+    char     str[]; // null-terminated
+} Eps_Symbol;
+
+// Returns the symbol for 'length' chars of 'str',
+// creating it on first use
+Eps_Symbol *
+EpsSymbol_Intern(const char *str, size_t length);
+
+uint32_t
+EpsSymbol_Hash(const char *str, size_t length);
+
+// Releases all the symbols
+void
+EpsSymbol_FreeAll(void);
+
+#endif
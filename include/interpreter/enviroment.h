@@ -1,7 +1,14 @@
 #ifndef _ENVIROMENT_H
 #   define _ENVIROMENT_H
 
-#include "core/ds/dict.h"
+#include "core/object.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Depth of the names bound in the global scope,
+// their frame is reached without walking the chain
+#define EPS_ENV_GLOBAL_DEPTH ((uint32_t)-1)
 
 typedef enum {
     SCOPE_GLOBAL = 0,
@@ -9,25 +16,75 @@ typedef enum {
     SCOPE_FUNC,
 } Eps_EnvScope;
 
+// Number of slots in the value stack frames are pushed on
+#define EPS_ENV_STACK_MAX (1 << 16)
+
+// Value stack owned by the global frame. Frames are nested
+// in C calls as well, so the C stack taken by them is limited too.
+typedef struct {
+    Eps_Object *slots;
+    Eps_Object *top;          // first free slot
+    size_t      depth;        // number of frames pushed
+    size_t      max_depth;
+    uintptr_t   native_base;  // C stack address the frames start at
+    size_t      native_limit; // C stack size the frames may take
+} Eps_EnvStack;
+
+// Scope frame, variables are addressed by the slots
+// the resolver assigned to them. Slots of the frames other than
+// global are pushed on the value stack, so a frame is released
+// by moving the stack top back.
 typedef struct eps_env_t {
     Eps_EnvScope scope;
-    EpsDict *variables;
     struct eps_env_t *enclosing;
+    struct eps_env_t *global;
+    Eps_EnvStack *stack;
+    size_t size;
+    Eps_Object *slots; // OBJ_UNDEFINED until defined
 } Eps_Env;
 
-void
-Eps_EnvDefine(Eps_Env *env, char *identifier, void *val);
+// Creates global frame with 'size' slots and the value stack
+// holding up to 'max_depth' frames
+Eps_Env *
+Eps_EnvCreate(size_t size, size_t max_depth);
 
+// Releases global frame along with the value stack
+// and the frames left on it
 void
 Eps_EnvDestroy(Eps_Env *env);
 
-void *
-Eps_EnvGetLocal(Eps_Env *env, char *identifier);
+// Grows global frame to 'size' slots
+void
+Eps_EnvResize(Eps_Env *env, size_t size);
+
+// Pushes 'frame' with 'size' slots on the value stack, returns
+// false if the stack is overflowed or 'max_depth' is reached
+bool
+Eps_EnvPush(Eps_Env *frame, Eps_Env *enclosing, Eps_EnvScope scope, size_t size);
 
-void *
-Eps_EnvGet(Eps_Env *env, char *identifier);
+// Releases values of the frame on top of the stack and pops it
+void
+Eps_EnvPop(Eps_Env *frame);
 
+// Replaces 'frame' by the 'next' frame pushed right above it,
+// so the frame of a function is reused by its tail call
+void
+Eps_EnvReplace(Eps_Env *frame, Eps_Env *next);
+
+// Releases values of the slots in ['from', 'to') and marks them undefined
+void
+Eps_EnvClear(Eps_Env *env, uint32_t from, uint32_t to);
+
+// Returns frame 'depth' scopes up from 'env'
 Eps_Env *
-Eps_EnvCreate(void);
+Eps_EnvAncestor(Eps_Env *env, uint32_t depth);
+
+// Returns variable slot resolved to ('depth', 'slot')
+Eps_Object *
+Eps_EnvGet(Eps_Env *env, uint32_t depth, uint32_t slot);
+
+// Defines variable holding 'val' in the current scope
+void
+Eps_EnvDefine(Eps_Env *env, uint32_t slot, Eps_Object val);
 
 #endif
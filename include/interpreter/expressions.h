@@ -5,7 +5,21 @@
 #include "parser.h"
 #include "core/object.h"
 
-Eps_Object *
-Eps_EvalExpr(Eps_Env *env, Eps_Expression* expr);
+Eps_Object
+Eps_EvalExpr(const Eps_Ast *ast, Eps_Env *env, Eps_AstIndex expr);
+
+// Evaluates expression in tail position of a function. If it ends
+// up with a call, frame of the callee is pushed to 'next' with the
+// arguments, but its body is not run, so the function frame can be
+// replaced by the callee; the callee is returned. Otherwise stores
+// value of the expression to 'val' and returns NULL.
+const Eps_StatementFunc *
+Eps_EvalTail(
+    const Eps_Ast *ast,
+    Eps_Env *env,
+    Eps_AstIndex expr,
+    Eps_Object *val,
+    Eps_Env *next
+);
 
 #endif
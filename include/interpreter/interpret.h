@@ -1,5 +1,12 @@
-#include "core/ds/list.h"
+#include "parser.h"
+#include <stddef.h>
 
+// Walks the program tree, calls nested deeper than 'max_depth'
+// fail with the stack overflow error
 void
-Eps_Interpret(EpsList *stmts);
+Eps_Interpret(Eps_Ast *ast, size_t max_depth);
+
+// Runs every top-level statement as soon as it is parsed
+void
+Eps_InterpretStream(Eps_Parser *parser, size_t max_depth);
 
@@ -0,0 +1,29 @@
+#ifndef _RESOLVER_H
+#   define _RESOLVER_H
+
+#include "parser.h"
+#include <stddef.h>
+#include <stdbool.h>
+
+// Binds every name of the program to the scope slot it
+// refers to, returns number of slots in the global scope
+size_t
+Eps_Resolve(Eps_Ast *ast);
+
+// Resolves program statement by statement, names are visible
+// from their definition on, functions may refer to later globals
+typedef struct Eps_Resolver Eps_Resolver;
+
+Eps_Resolver *
+EpsResolver_Create(Eps_Ast *ast);
+
+void
+EpsResolver_Destroy(Eps_Resolver *resolver);
+
+// Resolves next top-level statement, returns number of slots in
+// the global scope. Sets 'global_func' if the statement bound
+// a function to a global slot, nested ones included.
+size_t
+EpsResolver_Next(Eps_Resolver *resolver, Eps_AstIndex stmt, bool *global_func);
+
+#endif
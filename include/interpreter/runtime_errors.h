@@ -2,8 +2,19 @@
 #   define _RUNTIME_ERRORS_H
 
 #include "lexer/token.h"
+#include <setjmp.h>
 
 void
-EpsErr_RuntimeError(Eps_LexState *ls, char *format, ...);
+EpsErr_RuntimeError(Eps_SrcSpan span, char *format, ...);
+
+// Reports runtime error and unwinds to the handler set
+// by EpsErr_SetRuntimeHandler, so running code doesn't
+// have to check for errors
+_Noreturn void
+EpsErr_RuntimeThrow(Eps_SrcSpan span, char *format, ...);
+
+// Sets where runtime errors unwind to
+void
+EpsErr_SetRuntimeHandler(jmp_buf *handler);
 
 #endif
\ No newline at end of file
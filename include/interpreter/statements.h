@@ -5,20 +5,28 @@
 #include "parser.h"
 #include "core/object.h"
 
+// Returned by value, so running statements allocates nothing
 typedef struct {
     enum {
-        STMT_RES_RET = 0,
+        STMT_RES_NONE = 0, // statement completed normally
+        STMT_RES_RET,
+        STMT_RES_TAIL, // return of the call which body is not run yet
     } type;
 
     union {
         struct {
             Eps_StatementReturn *stmt;
-            Eps_Object *val;
+            Eps_Object val;
         } ret;
+        struct {
+            Eps_StatementReturn *stmt;
+            const Eps_StatementFunc *func;
+            Eps_Env frame; // callee frame holding the arguments
+        } tail;
     };
 } StmtResult;
 
-StmtResult *
-Eps_RunStatement(Eps_Env *env, Eps_Statement *stmt);
+StmtResult
+Eps_RunStatement(const Eps_Ast *ast, Eps_Env *env, Eps_AstIndex stmt);
 
 #endif
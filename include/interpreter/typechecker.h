@@ -0,0 +1,27 @@
+#ifndef _TYPECHECKER_H
+#   define _TYPECHECKER_H
+
+#include "parser.h"
+
+// Checks types of the resolved program and annotates expressions
+// with the types they evaluate to, so the interpreter skips
+// checks which are done up front. Calls are linked to the
+// functions they call, when the function is known.
+void
+Eps_TypeCheck(Eps_Ast *ast);
+
+// Checks program statement by statement, expressions referring
+// to globals which are not defined yet are checked at runtime
+typedef struct Eps_TypeChecker Eps_TypeChecker;
+
+Eps_TypeChecker *
+EpsTypeChecker_Create(Eps_Ast *ast);
+
+void
+EpsTypeChecker_Destroy(Eps_TypeChecker *checker);
+
+// Checks next resolved top-level statement
+void
+EpsTypeChecker_Next(Eps_TypeChecker *checker, Eps_AstIndex stmt);
+
+#endif
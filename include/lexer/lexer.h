@@ -1,10 +1,19 @@
 #ifndef EPS_LEXER
 #	define EPS_LEXER
 
-#include "core/ds/list.h"
+#include "lexer/token.h"
 #include "core/input.h"
 
-EpsList *
+// Prepares 'ls' to split 'input' into tokens one by one
+void
+Eps_LexInit(Eps_LexState *ls, Eps_Input *input);
+
+// Scans next token, <EOF> at the end of input
+Eps_Token
+Eps_LexToken(Eps_LexState *ls);
+
+// Splits input into tokens, the caller destroys the buffer
+Eps_TokenBuf *
 Eps_Lex(Eps_Input* input);
 
 #endif
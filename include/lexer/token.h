@@ -3,6 +3,7 @@
 
 #include "core/input.h"
 #include <stddef.h>
+#include <stdint.h>
 
 typedef enum {
 	L_PAREN = 0,
@@ -51,21 +52,42 @@ typedef enum {
 } Eps_TokenType;
 
 typedef struct {
-    size_t line;
-    size_t col;
 	size_t start;
 	size_t end;
 	size_t current;
 	char *fname;
 	Eps_Input *input;
+	bool discard; /* input skipped before the next token is not needed */
 } Eps_LexState;
 
+// Slice of the input an expression was read from.
 typedef struct {
+    uint64_t offset; // byte offset in the input, inputs may exceed 4 GiB
+    uint32_t length; // length in bytes
+} Eps_SrcSpan;
+
+// Token is a view into the input, it does not own its lexeme,
+// the parser materializes lexemes when it needs them.
+// Keep it small: the span is laid out inline so it fits in 16 bytes.
+typedef struct {
+    uint64_t      offset;
+    uint32_t      length;
     Eps_TokenType toktype;
-    Eps_LexState ls;
-    char *lexeme;
 } Eps_Token;
 
+static inline Eps_SrcSpan
+EpsToken_Span(const Eps_Token *tok)
+{
+    return (Eps_SrcSpan){ .offset = tok->offset, .length = tok->length };
+}
+
+// Tokens of the whole input, stored one after another
+typedef struct {
+    Eps_Token *items;
+    size_t     length;
+    size_t     capacity;
+} Eps_TokenBuf;
+
 // Warning: do not change the order
 static char  *_EpsDbg_TokenTypeStrings[] = {
 	"L_PAREN",
@@ -119,10 +141,18 @@ _EpsDbg_GetTokenTypeString(Eps_TokenType toktype);
 void
 _EpsDbg_TokenDump(Eps_Token *tok);
 
-Eps_Token *
-Eps_CreateToken(Eps_LexState *ls, Eps_TokenType toktype, char lexeme[]);
+// Returns the lexeme of tokens which are always spelled the same
+// way (operators, keywords), NULL for literals and identifiers
+const char *
+Eps_GetTokenLexeme(Eps_TokenType toktype);
+
+Eps_TokenBuf *
+EpsTokenBuf_Create(void);
+
+void
+EpsTokenBuf_Destroy(Eps_TokenBuf *buf);
 
 void
-Eps_DestroyToken(Eps_Token *tok);
+EpsTokenBuf_Push(Eps_TokenBuf *buf, Eps_Token tok);
 
 #endif
@@ -0,0 +1,24 @@
+#ifndef EPS_OPTIMIZER
+#   define EPS_OPTIMIZER
+
+#include "parser.h"
+
+// Folds constant expressions in place, simplifies identities
+// and substitutes top-level constants with their values
+void
+Eps_Optimize(Eps_Ast *ast);
+
+// Optimizes program statement by statement
+typedef struct Eps_Optimizer Eps_Optimizer;
+
+Eps_Optimizer *
+EpsOptimizer_Create(Eps_Ast *ast);
+
+void
+EpsOptimizer_Destroy(Eps_Optimizer *optimizer);
+
+// Optimizes next top-level statement
+void
+EpsOptimizer_Next(Eps_Optimizer *optimizer, Eps_AstIndex stmt);
+
+#endif
@@ -2,8 +2,9 @@
 #   define EPS_PARSER
 
 #include "ast.h"
-#include "core/ds/list.h"
 #include "core/object.h"
+#include "core/memory.h"
+#include <stdio.h>
 
 typedef Eps_AstNode Eps_Expression;
 
@@ -27,59 +28,190 @@ _EpsDbg_GetStmtTypeString(Eps_StatementType stmt_type);
 #endif
 
 typedef struct {
-    Eps_Expression *expr;
+    Eps_AstIndex expr;
 } Eps_StatementExpr;
 
-typedef EpsList Eps_StatementGroup;
+typedef struct {
+    Eps_AstList stmts;
+    bool        frame;      // whether the block has its own frame, blocks
+                            // in functions share the function frame
+    uint32_t    base;       // first slot of the block in the frame
+    uint32_t    scope_size; // number of slots in the block frame,
+                            // or the block takes in the shared frame
+    Eps_SrcSpan brace;      // opening brace
+} Eps_StatementGroup;
 
 typedef struct {
-    Eps_Token      *identifier; // variable identifier
-    Eps_Expression *expr;       // expression value to assign
-    Eps_ObjectType  type;       // variable value type
-    Eps_Token      *keyword;
+    Eps_Identifier identifier; // variable identifier
+    Eps_AstIndex   expr;       // expression value to assign
+    Eps_ObjectType type;       // variable value type, OBJ_ANY if
+                               // assigned variable type is not known
+    Eps_SrcSpan    keyword;
+    uint32_t       depth;      // scopes between the statement and the variable
+    uint32_t       slot;       // variable slot
 } Eps_StatementVar;
 
 typedef struct {
-    Eps_Token      *identifier; // function identifier
-    EpsList        *params;     // function parameters
-    Eps_Statement  *body;
-    Eps_ObjectType  type;       // return value type
-    Eps_Token      *keyword;
+    Eps_Identifier identifier;
+    Eps_ObjectType type;       // declared parameter type
+} Eps_Param;
+
+typedef struct {
+    Eps_Identifier identifier; // function identifier
+    Eps_AstList    params;     // function parameters in the parameter pool
+    Eps_AstIndex   body;
+    Eps_ObjectType type;       // return value type
+    Eps_SrcSpan    keyword;
+    uint32_t       slot;       // slot the function is bound to
+    uint32_t       scope_size; // number of slots in the function frame,
+                               // including the slots of its blocks
 } Eps_StatementFunc;
 
 typedef struct {
-    Eps_Expression *expr; // expression value to return
-    Eps_Token      *keyword;
+    Eps_AstIndex expr; // expression value to return, may be EPS_AST_NONE
+    Eps_SrcSpan  keyword;
 } Eps_StatementReturn;
 
 typedef struct {
-    Eps_Expression *expr; // expression value to output
-    Eps_Token      *keyword;
+    Eps_AstIndex expr; // expression value to output
+    Eps_SrcSpan  keyword;
 } Eps_StatementOutput;
 
 typedef struct {
-    Eps_Expression *cond;  // statment condition
-    Eps_Statement  *body;  // statement body
-    Eps_Statement  *_else; // else statement
-    Eps_Token      *keyword;
+    Eps_AstIndex cond;  // statment condition
+    Eps_AstIndex body;  // statement body
+    Eps_AstIndex _else; // else statement, may be EPS_AST_NONE
+    Eps_SrcSpan  keyword;
 } Eps_StatementConditional;
 
 struct Eps_Statement {
     Eps_StatementType type;
 
     union {
-        Eps_StatementExpr           *expr;
-        Eps_StatementOutput         *output;
-        Eps_StatementConditional    *conditional;
-        Eps_StatementGroup          *group;
-        Eps_StatementVar            *define;
-        Eps_StatementVar            *assign;
-        Eps_StatementFunc           *func;
-        Eps_StatementReturn         *ret;
+        Eps_StatementExpr           expr;
+        Eps_StatementOutput         output;
+        Eps_StatementConditional    conditional;
+        Eps_StatementGroup          group;
+        Eps_StatementVar            define;
+        Eps_StatementVar            assign;
+        Eps_StatementFunc           func;
+        Eps_StatementReturn         ret;
     };
 };
 
-// Represents code as AST
-EpsList *Eps_Parse(EpsList *tokens);
+// Growable array of nodes
+#define EPS_AST_POOL(type) \
+    struct { type *items; uint32_t length; uint32_t capacity; }
+
+// Program tree, nodes of each kind are stored contiguously
+typedef struct {
+    EPS_AST_POOL(Eps_Expression) exprs;
+    EPS_AST_POOL(Eps_Statement)  stmts;
+    EPS_AST_POOL(Eps_Call)       calls;
+    EPS_AST_POOL(Eps_Param)      params;
+    EPS_AST_POOL(Eps_AstIndex)   lists; // statement and argument lists
+
+    Eps_AstList program; // top-level statements
+} Eps_Ast;
+
+// Pool lengths, nodes added after the mark may be dropped
+typedef struct {
+    uint32_t exprs, stmts, calls, params, lists;
+} Eps_AstMark;
+
+Eps_Ast *
+EpsAst_Create(void);
+
+// Releases the tree along with the literals it holds
+void
+EpsAst_Destroy(Eps_Ast *ast);
+
+// Nodes are copied into the pools, returns index of the node
+Eps_AstIndex
+EpsAst_AddExpr(Eps_Ast *ast, const Eps_Expression *expr);
+
+Eps_AstIndex
+EpsAst_AddStmt(Eps_Ast *ast, const Eps_Statement *stmt);
+
+Eps_AstIndex
+EpsAst_AddCall(Eps_Ast *ast, const Eps_Call *call);
+
+Eps_AstIndex
+EpsAst_AddParam(Eps_Ast *ast, Eps_Param param);
+
+Eps_AstList
+EpsAst_AddList(Eps_Ast *ast, const Eps_AstIndex *items, uint32_t length);
+
+Eps_AstMark
+EpsAst_Mark(const Eps_Ast *ast);
+
+// Drops nodes added after the 'mark'
+void
+EpsAst_Rewind(Eps_Ast *ast, Eps_AstMark mark);
+
+// Prints program tree as s-expressions, one top-level statement per line
+void
+EpsAst_Dump(const Eps_Ast *ast, FILE *out);
+
+static inline Eps_Expression *
+EpsAst_Expr(const Eps_Ast *ast, Eps_AstIndex index)
+{
+    return &ast->exprs.items[index];
+}
+
+static inline Eps_Statement *
+EpsAst_Stmt(const Eps_Ast *ast, Eps_AstIndex index)
+{
+    return &ast->stmts.items[index];
+}
+
+static inline Eps_Call *
+EpsAst_Call(const Eps_Ast *ast, Eps_AstIndex index)
+{
+    return &ast->calls.items[index];
+}
+
+// Returns 'i'th parameter of the list
+static inline Eps_Param *
+EpsAst_Param(const Eps_Ast *ast, Eps_AstList params, uint32_t i)
+{
+    return &ast->params.items[params.start + i];
+}
+
+// Returns 'i'th node index of the list
+static inline Eps_AstIndex
+EpsAst_ListGet(const Eps_Ast *ast, Eps_AstList list, uint32_t i)
+{
+    return ast->lists.items[list.start + i];
+}
+
+// Represents code as AST, tokens are not referenced by the AST
+Eps_Ast *
+Eps_Parse(Eps_Input *input, Eps_TokenBuf *tokens);
+
+// Streaming parser, lexes the input as it goes
+typedef struct Eps_Parser Eps_Parser;
+
+Eps_Parser *
+EpsParser_Create(Eps_Input *input);
+
+// Destroys the parser along with its AST
+void
+EpsParser_Destroy(Eps_Parser *parser);
+
+// Returns the tree statements are parsed into
+Eps_Ast *
+EpsParser_Ast(Eps_Parser *parser);
+
+// Parses next top-level statement, returns
+// EPS_AST_NONE at the end of input. Source of
+// the statements parsed before may be discarded.
+Eps_AstIndex
+EpsParser_Next(Eps_Parser *parser);
+
+// Keeps source lines of the statement parsed last,
+// so errors inside it show them after it is discarded
+void
+EpsParser_KeepSource(Eps_Parser *parser);
 
 #endif
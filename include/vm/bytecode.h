@@ -0,0 +1,107 @@
+#ifndef EPS_BYTECODE
+#   define EPS_BYTECODE
+
+#include "lexer/token.h"
+#include "core/object.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Warning: do not change the order, the VM dispatch table
+// and the debug strings rely on it
+typedef enum {
+    OP_CONST = 0,     // [idx16]        push constant
+    OP_VOID,          //                push void
+    OP_POP,           //                pop value
+    OP_POPN,          // [n8]           pop 'n' values
+    OP_GET_LOCAL,     // [slot8]        push local
+    OP_SET_LOCAL,     // [slot8]        pop value into local
+    OP_GET_OUTER,     // [hops8 slot8]  push local of an enclosing function
+    OP_SET_OUTER,     // [hops8 slot8]  pop value into local of an enclosing function
+    OP_DEFINE_GLOBAL, // [idx16]        pop value into new global
+    OP_GET_GLOBAL,    // [idx16]        push global
+    OP_SET_GLOBAL,    // [idx16]        pop value into global
+    OP_CHECK_TYPE,    // [type8 kind8]  check top value type
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    OP_EQUAL,
+    OP_NOT_EQUAL,
+    OP_LESS,
+    OP_LESS_EQUAL,
+    OP_GREATER,
+    OP_GREATER_EQUAL,
+    OP_NEGATE,
+    OP_TO_STRING,
+    OP_JUMP,          // [off16]        jump forward
+    OP_JUMP_IF_FALSE, // [off16]        pop condition, jump if false
+    OP_CALL,          // [func16]       call function with args on stack
+    OP_RETURN,        //                return top value
+    OP_RETURN_VOID,   //                return void
+    OP_OUTPUT,        //                pop value and print it
+} Eps_OpCode;
+
+// Kinds of checks performed by OP_CHECK_TYPE,
+// used to pick the error message
+typedef enum {
+    CHECK_DEFINE = 0,
+    CHECK_CONST,
+    CHECK_PARAM,
+} Eps_CheckKind;
+
+typedef struct {
+    uint8_t       *code;
+    Eps_SrcSpan  *locs;    // source location of every byte of code
+    size_t         length;
+    size_t         capacity;
+
+    Eps_Object    *constants;
+    size_t         const_count;
+    size_t         const_capacity;
+} Eps_Chunk;
+
+typedef struct {
+    char           *name;
+    size_t          arity;
+    size_t          max_stack; // stack slots the frame may occupy
+    size_t          level;     // number of enclosing functions, the script's is 0
+    Eps_ObjectType  type;      // return value type
+    Eps_Chunk       chunk;
+} Eps_Function;
+
+typedef struct {
+    Eps_Function **functions; // functions[0] is the top-level script
+    size_t         func_count;
+
+    char         **global_names;
+    size_t         global_count;
+} Eps_Program;
+
+void
+EpsChunk_Init(Eps_Chunk *chunk);
+
+void
+EpsChunk_Write(Eps_Chunk *chunk, uint8_t byte, Eps_SrcSpan loc);
+
+size_t
+EpsChunk_AddConst(Eps_Chunk *chunk, Eps_Object val);
+
+void
+EpsChunk_Free(Eps_Chunk *chunk);
+
+Eps_Function *
+EpsFunction_Create(char *name);
+
+void
+EpsProgram_Destroy(Eps_Program *program);
+
+#ifdef EPS_DBG
+const char *
+_EpsDbg_GetOpCodeString(Eps_OpCode op);
+
+void
+_EpsDbg_ChunkDump(Eps_Function *func);
+#endif
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef EPS_COMPILER
+#   define EPS_COMPILER
+
+#include "vm/bytecode.h"
+#include "parser.h"
+
+// Compiles parsed statements into bytecode,
+// returns NULL if the program contains errors
+Eps_Program *
+Eps_Compile(const Eps_Ast *ast);
+
+#endif
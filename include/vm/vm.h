@@ -0,0 +1,12 @@
+#ifndef EPS_VM
+#   define EPS_VM
+
+#include "vm/bytecode.h"
+#include <stddef.h>
+
+// Runs compiled program on the stack machine, frames are kept
+// on the heap, so calls may be nested up to 'max_depth'
+void
+EpsVm_Run(Eps_Program *program, size_t max_depth);
+
+#endif
@@ -1,14 +1,71 @@
 #include "interpreter/enviroment.h"
-#include "core/ds/dict.h"
 #include "core/object.h"
 #include "core/memory.h"
 #include <stdio.h>
+#include <string.h>
+#include <sys/resource.h>
+
+// C stack size assumed when it is not limited
+#define NATIVE_STACK_DEFAULT (8 << 20)
+
+static void
+slots_init(Eps_Object *slots, size_t from, size_t to)
+{
+    for (; from < to; from++) {
+        slots[from].type = OBJ_UNDEFINED;
+    }
+}
+
+// Returns C stack size frames may take, the rest is left
+// for the calls made by the deepest frame
+static size_t
+native_stack_limit(void)
+{
+    struct rlimit limit;
+    size_t size = NATIVE_STACK_DEFAULT;
+
+    if (getrlimit(RLIMIT_STACK, &limit) == 0
+            && limit.rlim_cur != RLIM_INFINITY) {
+        size = limit.rlim_cur;
+    }
+
+    return size - size/4;
+}
+
+// Returns C stack size taken since the value stack was created
+static size_t
+native_stack_used(Eps_EnvStack *stack)
+{
+    char here;
+    uintptr_t addr = (uintptr_t)&here;
+
+    return addr < stack->native_base
+        ? stack->native_base - addr
+        : addr - stack->native_base;
+}
 
 Eps_Env *
-Eps_EnvCreate(void)
+Eps_EnvCreate(size_t size, size_t max_depth)
 {
     Eps_Env *env = EpsMem_Alloc(sizeof(Eps_Env));
-    env->variables = EpsDict_Create();
+    Eps_EnvStack *stack = EpsMem_Alloc(sizeof(Eps_EnvStack));
+    char base;
+
+    stack->slots = EpsMem_Alloc(sizeof(Eps_Object)*EPS_ENV_STACK_MAX);
+    stack->top = stack->slots;
+    stack->depth = 0;
+    stack->max_depth = max_depth;
+    stack->native_base = (uintptr_t)&base;
+    stack->native_limit = native_stack_limit();
+
+    env->scope = SCOPE_GLOBAL;
+    env->enclosing = NULL;
+    env->global = env;
+    env->stack = stack;
+    env->size = size;
+    env->slots = EpsMem_Alloc(sizeof(Eps_Object)*size);
+
+    slots_init(env->slots, 0, size);
 
     return env;
 }
@@ -16,36 +73,110 @@ Eps_EnvCreate(void)
 void
 Eps_EnvDestroy(Eps_Env *env)
 {
-    EpsDict_Destroy(env->variables, (void (*)(void *))(&EpsObject_Destroy));
+    Eps_EnvStack *stack = env->stack;
+    Eps_Object *slot;
+
+    // frames are left on the stack when a runtime error unwinds them
+    for (slot = stack->slots; slot < stack->top; slot++) {
+        EpsObject_Destroy(slot);
+    }
+
+    Eps_EnvClear(env, 0, env->size);
+
+    EpsMem_Free(env->stack->slots);
+    EpsMem_Free(env->stack);
+    EpsMem_Free(env->slots);
     EpsMem_Free(env);
 }
 
 void
-Eps_EnvDefine(Eps_Env *env, char *identifier, void *val)
+Eps_EnvResize(Eps_Env *env, size_t size)
+{
+    if (size <= env->size)
+        return;
+
+    env->slots = EpsMem_Realloc(env->slots, sizeof(Eps_Object)*size);
+    slots_init(env->slots, env->size, size);
+    env->size = size;
+}
+
+bool
+Eps_EnvPush(Eps_Env *frame, Eps_Env *enclosing, Eps_EnvScope scope, size_t size)
 {
-    EpsDict_Set(env->variables, identifier, val);
+    Eps_EnvStack *stack = enclosing->stack;
+    size_t left = stack->slots + EPS_ENV_STACK_MAX - stack->top;
+
+    if (stack->depth == stack->max_depth || size > left
+            || native_stack_used(stack) > stack->native_limit) {
+        return false;
+    }
+
+    frame->scope = scope;
+    frame->enclosing = enclosing;
+    frame->global = enclosing->global;
+    frame->stack = stack;
+    frame->size = size;
+    frame->slots = stack->top;
+
+    stack->top += size;
+    stack->depth++;
+    slots_init(frame->slots, 0, size);
+
+    return true;
 }
 
-void *
-Eps_EnvGetLocal(Eps_Env *env, char *identifier)
+void
+Eps_EnvPop(Eps_Env *frame)
 {
-    return EpsDict_Get(env->variables, identifier);
+    Eps_EnvClear(frame, 0, frame->size);
+
+    frame->stack->top = frame->slots;
+    frame->stack->depth--;
 }
 
-void *
-Eps_EnvGet(Eps_Env *env, char *identifier)
+void
+Eps_EnvReplace(Eps_Env *frame, Eps_Env *next)
 {
-    Eps_Env *current_env = env;
-    Eps_Object *val;
+    Eps_EnvClear(frame, 0, frame->size);
+    memmove(frame->slots, next->slots, sizeof(Eps_Object)*next->size);
 
-    while (current_env != NULL) {
-        val = Eps_EnvGetLocal(current_env, identifier);
+    frame->scope = next->scope;
+    frame->enclosing = next->enclosing;
+    frame->size = next->size;
+    frame->stack->top = frame->slots + frame->size;
+    frame->stack->depth--;
+}
 
-        if(val != NULL)
-            return val;
+void
+Eps_EnvClear(Eps_Env *env, uint32_t from, uint32_t to)
+{
+    for (; from < to; from++) {
+        EpsObject_Destroy(&env->slots[from]);
+        env->slots[from].type = OBJ_UNDEFINED;
+    }
+}
+
+Eps_Env *
+Eps_EnvAncestor(Eps_Env *env, uint32_t depth)
+{
+    if (depth == EPS_ENV_GLOBAL_DEPTH)
+        return env->global;
 
-        current_env = current_env->enclosing;
+    while (depth-- > 0) {
+        env = env->enclosing;
     }
 
-    return NULL;
+    return env;
+}
+
+Eps_Object *
+Eps_EnvGet(Eps_Env *env, uint32_t depth, uint32_t slot)
+{
+    return &Eps_EnvAncestor(env, depth)->slots[slot];
+}
+
+void
+Eps_EnvDefine(Eps_Env *env, uint32_t slot, Eps_Object val)
+{
+    env->slots[slot] = val;
 }
@@ -10,332 +10,592 @@
 #include "core/memory.h"
 #include <string.h>
 
-#define EXPRESSION_GUARD() if (EpsErr_WasError()) return NULL;
-
 // *  - Utils -
-static Eps_Object *
+static Eps_Object
 create_number(double val)
 {
-    double *obj_val = EpsMem_Alloc(sizeof(double));
-    *obj_val = val;
+    Eps_Object obj = { .type = OBJ_REAL, .real = val };
 
-    return EpsObject_Create(OBJ_REAL, obj_val, true);
+    return obj;
 }
 
-static Eps_Object *
+static Eps_Object
 create_boolean(bool val)
 {
-    double *obj_val = EpsMem_Alloc(sizeof(bool));
-    *obj_val = val;
+    Eps_Object obj = { .type = OBJ_BOOL, .boolean = val };
 
-    return EpsObject_Create(OBJ_BOOL, obj_val, true);
+    return obj;
 }
 
-static Eps_Object *
-create_string(char *str)
-{
-    return EpsObject_Create(OBJ_STRING, str, true);
-}
-
-static Eps_Object *
+static Eps_Object
 create_void()
 {
-    return EpsObject_Create(OBJ_VOID, NULL, true);
+    Eps_Object obj = { .type = OBJ_VOID, .string = NULL };
+
+    return obj;
 }
 
-static Eps_Object *
-concat_strings(Eps_Object *left, Eps_Object *right)
+// * - Evaluating Expressions -
+
+// Evaluates ternary condition, returns the branch it selects
+static Eps_AstIndex
+select_branch(const Eps_Ast *ast, Eps_Env *env, Eps_Expression *node)
 {
-    size_t len = 80;
-    char *buff = EpsMem_Alloc(sizeof(char)*len);
-
-    sprintf(
-        buff,
-        "%s%s",
-        (char *)left->value,
-        (char *)right->value
-    );
+    Eps_Expression *cond_node = EpsAst_Expr(ast, node->ternary.cond);
+    Eps_Object cond = Eps_EvalExpr(ast, env, node->ternary.cond);
+
+    // conditions of the unknown type are checked at runtime
+    if (cond_node->value_type == OBJ_ANY && cond.type != OBJ_BOOL) {
+        const char *type = EpsDbg_GetObjectTypeString(cond.type);
+
+        EpsObject_Destroy(&cond);
+        EpsErr_RuntimeThrow(
+            cond_node->span,
+            "invalid condition type '%s'",
+            type
+        );
+    }
 
-    return create_string(buff);
+    return cond.boolean ? node->ternary.left : node->ternary.right;
 }
 
-// * - Evaluating Expressions -
-Eps_Object *
-Eps_EvalExpr(Eps_Env *env, Eps_Expression* expr);
-
-static Eps_Object *
-visit_ternary(Eps_Env *env, Eps_AstTernaryNode* node)
+static Eps_Object
+visit_ternary(const Eps_Ast *ast, Eps_Env *env, Eps_Expression *node)
 {
-    EXPRESSION_GUARD();
     _DEBUG("%*sTERNARY\n", 8, "");
-    Eps_Object *cond = Eps_EvalExpr(env, node->cond);
-
-    if (cond->type != OBJ_BOOL) {
-        // TODO: Throw runtime error
-        return create_void();
-    }
 
-    if (*(double *)cond->value) {
-        return Eps_EvalExpr(env, node->left);
-    } else {
-        return Eps_EvalExpr(env, node->right);
-    }
+    return Eps_EvalExpr(ast, env, select_branch(ast, env, node));
 }
 
-static Eps_Object *
-visit_binary(Eps_Env *env, Eps_AstBinNode* node)
+static Eps_Object
+binary_real(Eps_TokenType operator, double lval, double rval)
 {
-    EXPRESSION_GUARD();
+    switch (operator) {
+        case PLUS:
+            return create_number(lval + rval);
 
-    _DEBUG("%*sBINARY %s\n", 8, "",
-        _EpsDbg_GetTokenTypeString(node->operator->toktype));
+        case MINUS:
+            return create_number(lval - rval);
 
-    Eps_Object *left = Eps_EvalExpr(env, node->left);
-    Eps_Object *right = Eps_EvalExpr(env, node->right);
+        case STAR:
+            return create_number(lval * rval);
 
-    if (left->type == OBJ_REAL && right->type == OBJ_REAL) {
-        double lval = *(double *)left->value;
-        double rval = *(double *)right->value;
+        case SLASH:
+            return create_number(lval / rval);
 
-        switch (node->operator->toktype) {
-            case PLUS:
-                return create_number(lval + rval);
+        case EQUAL:
+            return create_boolean(lval == rval);
 
-            case MINUS:
-                return create_number(lval - rval);
+        case BANG_EQUAL:
+            return create_boolean(lval != rval);
 
-            case STAR:
-                return create_number(lval * rval);
+        case LESS_EQUAL:
+            return create_boolean(lval <= rval);
 
-            case SLASH:
-                return create_number(lval / rval);
+        case GREATER_EQUAL:
+            return create_boolean(lval >= rval);
 
-            case EQUAL:
-                return create_boolean(lval == rval);
+        case LESS:
+            return create_boolean(lval < rval);
 
-            case BANG_EQUAL:
-                return create_boolean(lval != rval);
+        case GREATER:
+            return create_boolean(lval > rval);
 
-            case LESS_EQUAL:
-                return create_boolean(lval <= rval);
+        default: break;
+    }
 
-            case GREATER_EQUAL:
-                return create_boolean(lval >= rval);
+    return create_void();
+}
 
-            case LESS:
-                return create_boolean(lval < rval);
+// Evaluates operator on operands of any type
+static Eps_Object
+binary_generic(Eps_Expression *node, Eps_Object *left, Eps_Object *right)
+{
+    const char *ltype = EpsDbg_GetObjectTypeString(left->type);
+    const char *rtype = EpsDbg_GetObjectTypeString(right->type);
+    bool strings = left->type == OBJ_STRING && right->type == OBJ_STRING;
 
-            case GREATER:
-                return create_boolean(lval > rval);
+    if (left->type == OBJ_REAL && right->type == OBJ_REAL)
+        return binary_real(node->operator, left->real, right->real);
 
-            default: break;
-        }
+    if (strings && node->operator == PLUS)
+        return EpsObject_Concat(*left, *right);
+
+    if (strings && (node->operator == EQUAL || node->operator == BANG_EQUAL)) {
+        bool equal = EpsString_Equal(left->string, right->string);
+
+        EpsObject_Destroy(left);
+        EpsObject_Destroy(right);
+
+        return create_boolean(node->operator == EQUAL ? equal : !equal);
     }
-    else if (left->type == OBJ_STRING && right->type == OBJ_STRING) {
-        switch (node->operator->toktype) {
-            case PLUS:
-                return concat_strings(left, right);
-            default:
-            {
-                EpsErr_RuntimeError(
-                    &node->operator->ls,
-                    "cannot apply '%s' to arguments type 'string'",
-                    node->operator->lexeme
-                );
-            }
+
+    EpsObject_Destroy(left);
+    EpsObject_Destroy(right);
+
+    if (strings) {
+        EpsErr_RuntimeThrow(
+            node->binary.op_span,
+            "cannot apply '%s' to arguments type 'string'",
+            Eps_GetTokenLexeme(node->operator)
+        );
+    }
+
+    EpsErr_RuntimeThrow(
+        node->binary.op_span,
+        "cannot apply binary operator to operands type '%s' and '%s'",
+        ltype,
+        rtype
+    );
+}
+
+// Picks specialization for the operand types node is evaluated with
+static Eps_AstQuickType
+quicken_binary(Eps_Expression *node, Eps_Object *left, Eps_Object *right)
+{
+    if (left->type == OBJ_REAL && right->type == OBJ_REAL) {
+        switch (node->operator) {
+            case PLUS:          return QUICK_ADD_REAL_REAL;
+            case MINUS:         return QUICK_SUB_REAL_REAL;
+            case STAR:          return QUICK_MUL_REAL_REAL;
+            case SLASH:         return QUICK_DIV_REAL_REAL;
+            case EQUAL:         return QUICK_EQUAL_REAL_REAL;
+            case BANG_EQUAL:    return QUICK_NOT_EQUAL_REAL_REAL;
+            case LESS:          return QUICK_LESS_REAL_REAL;
+            case LESS_EQUAL:    return QUICK_LESS_EQUAL_REAL_REAL;
+            case GREATER:       return QUICK_GREATER_REAL_REAL;
+            case GREATER_EQUAL: return QUICK_GREATER_EQUAL_REAL_REAL;
+            default: break;
         }
     }
-    else {
-        EpsErr_RuntimeError(
-            &node->operator->ls,
-            "cannot apply binary operator to operands type '%s' and '%s'",
-            EpsDbg_GetObjectTypeString(left->type),
-            EpsDbg_GetObjectTypeString(right->type)
-        );
+
+    if (left->type == OBJ_STRING && right->type == OBJ_STRING
+            && node->operator == PLUS)
+        return QUICK_CONCAT_STR_STR;
+
+    return QUICK_GENERIC;
+}
+
+// Specialized variants guard operand types,
+// unless the types are checked statically
+#define QUICK_GUARD(t) \
+    (node->value_type != OBJ_ANY || (left.type == (t) && right.type == (t)))
+
+static Eps_Object
+visit_binary(const Eps_Ast *ast, Eps_Env *env, Eps_Expression *node)
+{
+    _DEBUG("%*sBINARY %s\n", 8, "",
+        _EpsDbg_GetTokenTypeString(node->operator));
+
+    Eps_Object left = Eps_EvalExpr(ast, env, node->binary.left);
+    Eps_Object right = Eps_EvalExpr(ast, env, node->binary.right);
+
+    switch (node->quick) {
+        case QUICK_ADD_REAL_REAL:
+            if (QUICK_GUARD(OBJ_REAL))
+                return create_number(left.real + right.real);
+        break;
+        case QUICK_SUB_REAL_REAL:
+            if (QUICK_GUARD(OBJ_REAL))
+                return create_number(left.real - right.real);
+        break;
+        case QUICK_MUL_REAL_REAL:
+            if (QUICK_GUARD(OBJ_REAL))
+                return create_number(left.real * right.real);
+        break;
+        case QUICK_DIV_REAL_REAL:
+            if (QUICK_GUARD(OBJ_REAL))
+                return create_number(left.real / right.real);
+        break;
+        case QUICK_EQUAL_REAL_REAL:
+            if (QUICK_GUARD(OBJ_REAL))
+                return create_boolean(left.real == right.real);
+        break;
+        case QUICK_NOT_EQUAL_REAL_REAL:
+            if (QUICK_GUARD(OBJ_REAL))
+                return create_boolean(left.real != right.real);
+        break;
+        case QUICK_LESS_REAL_REAL:
+            if (QUICK_GUARD(OBJ_REAL))
+                return create_boolean(left.real < right.real);
+        break;
+        case QUICK_LESS_EQUAL_REAL_REAL:
+            if (QUICK_GUARD(OBJ_REAL))
+                return create_boolean(left.real <= right.real);
+        break;
+        case QUICK_GREATER_REAL_REAL:
+            if (QUICK_GUARD(OBJ_REAL))
+                return create_boolean(left.real > right.real);
+        break;
+        case QUICK_GREATER_EQUAL_REAL_REAL:
+            if (QUICK_GUARD(OBJ_REAL))
+                return create_boolean(left.real >= right.real);
+        break;
+        case QUICK_CONCAT_STR_STR:
+        {
+            if (QUICK_GUARD(OBJ_STRING))
+                return EpsObject_Concat(left, right);
+        } break;
+        case QUICK_GENERIC:
+            return binary_generic(node, &left, &right);
+        default: break;
     }
 
-    EpsObject_Destroy(left);
-    EpsObject_Destroy(right);
+    // first evaluation specializes the node, once the guard
+    // fails the node stays generic
+    node->quick = node->quick == QUICK_NONE
+        ? quicken_binary(node, &left, &right)
+        : QUICK_GENERIC;
 
-    return create_void();
+    return binary_generic(node, &left, &right);
 }
 
-static Eps_Object *
-visit_unary(Eps_Env *env, Eps_AstUnaryNode* node)
+static Eps_Object
+visit_unary(const Eps_Ast *ast, Eps_Env *env, Eps_Expression *node)
 {
-    EXPRESSION_GUARD();
     _DEBUG("%*sUNARY\n", 8, "");
-    Eps_Object *right = Eps_EvalExpr(env, node->right);
+    Eps_Object right = Eps_EvalExpr(ast, env, node->unary.right);
+    const char *type = EpsDbg_GetObjectTypeString(right.type);
 
-    switch (node->operator->toktype) {
+    switch (node->operator) {
         case MINUS:
         {
-            if (right->type != OBJ_REAL) {
-                EpsErr_RuntimeError(
-                    &node->operator->ls,
+            if (node->value_type == OBJ_ANY && right.type != OBJ_REAL) {
+                EpsObject_Destroy(&right);
+                EpsErr_RuntimeThrow(
+                    node->unary.op_span,
                     "cannot apply %s to expression type %s",
-                    node->operator->lexeme,
-                    EpsDbg_GetObjectTypeString(right->type)
+                    Eps_GetTokenLexeme(node->operator),
+                    type
                 );
-
-                return create_void();
             }
 
-            return create_number(- *(double *)right->value);
+            return create_number(-right.real);
         } break;
         case STR:
-            return EpsObject_ToString(right);
-        default:
         {
-            EpsErr_RuntimeError(
-                &node->operator->ls,
-                "unknown operator '%s'",
-                node->operator->lexeme
-            );
-        };
+            if (node->value_type == OBJ_ANY && right.type == OBJ_VOID) {
+                EpsErr_RuntimeThrow(
+                    node->unary.op_span,
+                    "cannot apply str to expression type void"
+                );
+            }
+
+            Eps_Object res = EpsObject_ToString(right);
+
+            EpsObject_Destroy(&right);
+            return res;
+        }
+        default: break;
     }
 
-    EpsObject_Destroy(right);
-    return right;
+    EpsObject_Destroy(&right);
+    EpsErr_RuntimeThrow(
+        node->unary.op_span,
+        "unknown operator '%s'",
+        Eps_GetTokenLexeme(node->operator)
+    );
 }
 
-static Eps_Object *
-visit_call(Eps_Env *env, Eps_AstPrimaryNode *node)
+// Finds function the 'call' calls and the frame it is defined in
+static const Eps_StatementFunc *
+find_callee(const Eps_Ast *ast, Eps_Env *env, Eps_Call *call, Eps_Env **closure)
 {
-    _DEBUG("%*sPRIMARY\n", 12, "");
-    Eps_StatementFunc *func = Eps_EnvGet(env, node->func->identifier->lexeme);
-
-    if (func == NULL) { // if function is not defined
-        EpsErr_RuntimeError(
-            &node->func->identifier->ls,
-            "call undefined function '%s'",
-            node->func->identifier->lexeme
-        );
-    }
+    Eps_AstIndex decl = call->func;
 
-    Eps_Env *func_env = Eps_EnvCreate();
-    func_env->scope = SCOPE_FUNC;
-    func_env->enclosing = env;
+    *closure = Eps_EnvAncestor(env, call->depth);
 
-    EpsList_Node *current_arg = node->func->args->head;
-    EpsList_Node *current_param = func->params->head;
+    // callee which is not linked is looked up in its scope
+    if (decl == EPS_AST_NONE) {
+        Eps_Object *callee = &(*closure)->slots[call->slot];
 
-    while (current_param != NULL) {
-        if (current_arg == NULL) { // if we're out of arguments
-            EpsErr_RuntimeError(
-                &node->func->identifier->ls,
-                "too few arguments in function '%s' call",
-                node->func->identifier->lexeme
+        if (callee->type != OBJ_FUNC) { // if function is not defined yet
+            EpsErr_RuntimeThrow(
+                call->identifier.span,
+                "call undefined function '%s'",
+                call->identifier.name->str
             );
-
-            return create_void();
         }
 
-        Eps_EnvDefine(
-            func_env,
-            ((Eps_Token *)current_param->data)->lexeme,
-            Eps_EvalExpr(env, current_arg->data)
-        );
+        decl = callee->func;
+    }
+
+    const Eps_StatementFunc *func = &EpsAst_Stmt(ast, decl)->func;
+    uint32_t argc = call->args.length;
 
-        current_arg = current_arg->next;
-        current_param = current_param->next;
+    // arity of the checked calls is known to match
+    if (!call->checked && argc < func->params.length) { // if we're out of arguments
+        EpsErr_RuntimeThrow(
+            call->identifier.span,
+            "too few arguments in function '%s' call",
+            call->identifier.name->str
+        );
     }
 
-    if (current_arg != NULL) { // if there is arguments left
-        EpsErr_RuntimeError(
-            &node->func->identifier->ls,
+    if (!call->checked && argc > func->params.length) { // if there is arguments left
+        EpsErr_RuntimeThrow(
+            call->identifier.span,
             "too much argiments in '%s' function call",
-            node->func->identifier->lexeme
+            call->identifier.name->str
         );
+    }
+
+    return func;
+}
+
+// Pushes frame of the 'func' holding arguments of the 'call'
+// evaluated in 'env'
+static void
+push_frame(
+    const Eps_Ast *ast,
+    Eps_Env *env,
+    Eps_Call *call,
+    const Eps_StatementFunc *func,
+    Eps_Env *closure,
+    Eps_Env *frame
+)
+{
+    uint32_t i;
+
+    // function frame encloses the frame function is defined in
+    if (!Eps_EnvPush(frame, closure, SCOPE_FUNC, func->scope_size))
+        EpsErr_RuntimeThrow(call->identifier.span, "stack overflow");
+
+    // parameters take the first slots
+    for (i = 0; i < call->args.length; i++) {
+        Eps_AstIndex arg_node = EpsAst_ListGet(ast, call->args, i);
+        Eps_Object arg = Eps_EvalExpr(ast, env, arg_node);
+        const Eps_Param *param = EpsAst_Param(ast, func->params, i);
+
+        if (!call->checked && param->type != OBJ_ANY
+                && arg.type != param->type) {
+            const char *type = EpsDbg_GetObjectTypeString(arg.type);
+
+            EpsObject_Destroy(&arg);
+            EpsErr_RuntimeThrow(
+                EpsAst_Expr(ast, arg_node)->span,
+                "cannot pass '%s' as parameter '%s' type '%s'",
+                type,
+                param->identifier.name->str,
+                EpsDbg_GetObjectTypeString(param->type)
+            );
+        }
 
-        return create_void();
+        Eps_EnvDefine(frame, i, arg);
     }
+}
+
+// Runs body of the 'func' in its pushed 'frame', then pops the frame
+static Eps_Object
+run_func(const Eps_Ast *ast, const Eps_StatementFunc *func, Eps_Env *frame)
+{
+    Eps_StatementReturn *tail_ret = NULL; // return of the last tail call
+    Eps_Object val = create_void();
+
+    for (;;) {
+        StmtResult stmt_res = Eps_RunStatement(ast, frame, func->body);
+        Eps_StatementReturn *stmt;
+
+        // bare return leaves the function as falling off its end does
+        if (stmt_res.type == STMT_RES_RET
+                && stmt_res.ret.stmt->expr == EPS_AST_NONE)
+            stmt_res.type = STMT_RES_NONE;
+
+        // if function didn't return value
+        if (stmt_res.type == STMT_RES_NONE) {
+            Eps_Expression *ret = tail_ret != NULL
+                ? EpsAst_Expr(ast, tail_ret->expr)
+                : NULL;
+
+            // function called in tail position returned void
+            // instead of the value of the caller type
+            if (ret != NULL && ret->value_type == OBJ_ANY
+                    && func->type != OBJ_VOID) {
+                EpsErr_RuntimeThrow(
+                    ret->span,
+                    "cannot return 'void' from a function type '%s'",
+                    EpsDbg_GetObjectTypeString(func->type)
+                );
+            }
+
+            break;
+        }
+
+        if (stmt_res.type == STMT_RES_RET) {
+            stmt = stmt_res.ret.stmt;
+            val = stmt_res.ret.val;
+        } else {
+            const Eps_StatementFunc *callee = stmt_res.tail.func;
 
-    StmtResult *stmt_res = Eps_RunStatement(func_env, func->body);
-    Eps_Object *val;
+            stmt = stmt_res.tail.stmt;
 
-    // if function returned value
-    if (stmt_res && stmt_res->type == STMT_RES_RET) {
-        val = stmt_res->ret.val;
+            // callee returning the same type replaces the frame,
+            // so its return value needs no more checks here
+            if (callee->type == func->type) {
+                Eps_EnvReplace(frame, &stmt_res.tail.frame);
+                func = callee;
+                tail_ret = stmt;
 
-        if (val->type != func->type) {
-            EpsErr_RuntimeError(
-                &stmt_res->ret.stmt->expr->ls,
+                continue;
+            }
+
+            val = run_func(ast, callee, &stmt_res.tail.frame);
+        }
+
+        Eps_Expression *ret = EpsAst_Expr(ast, stmt->expr);
+
+        // values of the known type are checked up front
+        if (ret->value_type == OBJ_ANY && val.type != func->type) {
+            const char *type = EpsDbg_GetObjectTypeString(val.type);
+
+            EpsObject_Destroy(&val);
+            EpsErr_RuntimeThrow(
+                ret->span,
                 "cannot return '%s' from a function type '%s'",
-                EpsDbg_GetObjectTypeString(val->type),
+                type,
                 EpsDbg_GetObjectTypeString(func->type)
             );
         }
-    } else {
-        val = create_void();
+
+        break;
     }
 
-    // Eps_EnvDestroy(func_env);
+    Eps_EnvPop(frame);
 
     return val;
 }
 
-static Eps_Object *
-visit_primary(Eps_Env *env, Eps_AstPrimaryNode *node)
+static Eps_Object
+call_func(
+    const Eps_Ast *ast,
+    Eps_Env *env,
+    Eps_Call *call,
+    const Eps_StatementFunc *func,
+    Eps_Env *closure
+)
 {
-    EXPRESSION_GUARD();
-    _DEBUG("%*sPRIMARY, type=%u\n", 8, "", node->type);
-    switch (node->type) {
+    Eps_Env frame;
+
+    push_frame(ast, env, call, func, closure, &frame);
+
+    return run_func(ast, func, &frame);
+}
+
+static Eps_Object
+visit_call(const Eps_Ast *ast, Eps_Env *env, Eps_Call *call)
+{
+    _DEBUG("%*sPRIMARY\n", 12, "");
+    Eps_Env *closure;
+    const Eps_StatementFunc *func = find_callee(ast, env, call, &closure);
+
+    return call_func(ast, env, call, func, closure);
+}
+
+static Eps_Object
+visit_primary(const Eps_Ast *ast, Eps_Env *env, Eps_Expression *node)
+{
+    _DEBUG("%*sPRIMARY, type=%u\n", 8, "", node->primary);
+    switch (node->primary) {
         case PRIMARY_LIT:
         {
-            return node->literal;
+            return EpsObject_Clone(node->literal);
         } break;
         case PRIMARY_PAREN:
         {
-            return Eps_EvalExpr(env, node->expr);
+            return Eps_EvalExpr(ast, env, node->expr);
         } break;
         case PRIMARY_CALL:
         {
-            _DEBUG("%*sCALL FUNCTION '%s'\n", 12, "", node->func->identifier->lexeme);
-            return visit_call(env, node);
+            Eps_Call *call = EpsAst_Call(ast, node->call);
+
+            _DEBUG("%*sCALL FUNCTION '%s'\n", 12, "", call->identifier.name->str);
+            return visit_call(ast, env, call);
         } break;
         case PRIMARY_ID:
         {
-            Eps_Object *ref = Eps_EnvGet(
-                env,
-                node->identifier->lexeme
-            );
+            Eps_Object *ref = Eps_EnvGet(env, node->var.depth, node->var.slot);
 
-            if(ref != NULL) {
-                return EpsObject_Clone(ref);
-            } else {
-                EpsErr_RuntimeError(
-                    &node->identifier->ls,
+            if(ref->type == OBJ_UNDEFINED) {
+                EpsErr_RuntimeThrow(
+                    node->span,
                     "reference to undefined name '%s'",
-                    node->identifier->lexeme
+                    node->var.name->str
                 );
             }
+
+            return EpsObject_Clone(*ref);
         } break;
     }
 
     return create_void();
 }
 
-Eps_Object *
-Eps_EvalExpr(Eps_Env *env, Eps_Expression* expr)
+const Eps_StatementFunc *
+Eps_EvalTail(
+    const Eps_Ast *ast,
+    Eps_Env *env,
+    Eps_AstIndex index,
+    Eps_Object *val,
+    Eps_Env *next
+)
+{
+    for (;;) {
+        Eps_Expression *expr = EpsAst_Expr(ast, index);
+
+        if (expr->type == NODE_TERNARY) {
+            index = select_branch(ast, env, expr);
+            continue;
+        }
+
+        if (expr->type != NODE_PRIMARY)
+            break;
+
+        if (expr->primary == PRIMARY_PAREN) {
+            index = expr->expr;
+            continue;
+        }
+
+        // functions defined in the current frame can't replace it
+        if (expr->primary == PRIMARY_CALL
+                && EpsAst_Call(ast, expr->call)->depth != 0) {
+            Eps_Call *call = EpsAst_Call(ast, expr->call);
+            Eps_Env *closure;
+            const Eps_StatementFunc *func = find_callee(ast, env, call, &closure);
+
+            push_frame(ast, env, call, func, closure, next);
+
+            return func;
+        }
+
+        break;
+    }
+
+    *val = Eps_EvalExpr(ast, env, index);
+
+    return NULL;
+}
+
+Eps_Object
+Eps_EvalExpr(const Eps_Ast *ast, Eps_Env *env, Eps_AstIndex index)
 {
-    EXPRESSION_GUARD();
     _DEBUG("    EXPRESSION:\n");
+    Eps_Expression *expr = EpsAst_Expr(ast, index);
+
     switch (expr->type) {
         case NODE_TERNARY:
-            return visit_ternary(env, expr->ternary);
+            return visit_ternary(ast, env, expr);
 
         case NODE_BIN:
-            return visit_binary(env, expr->binary);
+            return visit_binary(ast, env, expr);
 
         case NODE_UNARY:
-            return visit_unary(env, expr->unary);
+            return visit_unary(ast, env, expr);
 
         case NODE_PRIMARY:
-            return visit_primary(env, expr->primary);
+            return visit_primary(ast, env, expr);
 
         default: break;
     }
 
-    return NULL;
+    return create_void();
 }
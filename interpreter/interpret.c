@@ -1,33 +1,120 @@
 #include "interpreter/interpret.h"
 #include "interpreter/enviroment.h"
 #include "interpreter/statements.h"
+#include "interpreter/resolver.h"
+#include "interpreter/typechecker.h"
 #include "interpreter/runtime_errors.h"
-#include "core/memory.h"
+#include "core/errors.h"
 #include "core/debug_macros.h"
 #include "parser.h"
+#include "optimizer.h"
 #include <string.h>
 #include <stdio.h>
 #include <stdarg.h>
+#include <setjmp.h>
+
+static void
+run_global(const Eps_Ast *ast, Eps_Env *env, Eps_AstIndex stmt)
+{
+    StmtResult res = Eps_RunStatement(ast, env, stmt);
+
+    if (res.type == STMT_RES_RET) {
+        EpsObject_Destroy(&res.ret.val);
+        EpsErr_RuntimeThrow(
+            res.ret.stmt->keyword,
+            "cannot return outside of the function"
+        );
+    }
+}
 
 void
-Eps_Interpret(EpsList *stmts)
+Eps_Interpret(Eps_Ast *ast, size_t max_depth)
 {
     _DEBUG("--------------- INTERPRETER ---------------\n");
 
-    EpsList_Node *stmt = stmts->head;
-    Eps_Env *env = Eps_EnvCreate();
+    size_t globals = Eps_Resolve(ast);
+
+    if (EpsErr_WasError())
+        return;
+
+    Eps_TypeCheck(ast);
+
+    if (EpsErr_WasError())
+        return;
 
-    while (!EpsErr_WasError() && stmt != NULL) {
-        StmtResult *res = Eps_RunStatement(env, (Eps_Statement *)stmt->data);
+    Eps_Env *env = Eps_EnvCreate(globals, max_depth);
+    jmp_buf handler;
+    uint32_t i;
 
-        if (res != NULL && res->type == STMT_RES_RET) {
-            EpsErr_RuntimeError(
-                &res->ret.stmt->keyword->ls,
-                "cannot return outside of the function"
-            );
+    // runtime errors unwind here, frames left on the
+    // stack are released along with the global frame
+    if (setjmp(handler) == 0) {
+        EpsErr_SetRuntimeHandler(&handler);
+
+        for (i = 0; i < ast->program.length; i++) {
+            run_global(ast, env, EpsAst_ListGet(ast, ast->program, i));
         }
+    }
+
+    EpsErr_SetRuntimeHandler(NULL);
+    Eps_EnvDestroy(env);
+}
 
-        EpsMem_Free(res);
-        stmt = stmt->next;
+void
+Eps_InterpretStream(Eps_Parser *parser, size_t max_depth)
+{
+    _DEBUG("--------------- INTERPRETER ---------------\n");
+
+    Eps_Ast *ast = EpsParser_Ast(parser);
+    Eps_Resolver *resolver = EpsResolver_Create(ast);
+    Eps_Optimizer *optimizer = EpsOptimizer_Create(ast);
+    Eps_TypeChecker *checker = EpsTypeChecker_Create(ast);
+    Eps_Env *env = Eps_EnvCreate(0, max_depth);
+    jmp_buf handler;
+
+    // runtime error stops the program, other errors
+    // are checked after every phase
+    if (setjmp(handler) == 0) {
+        EpsErr_SetRuntimeHandler(&handler);
+
+        for (;;) {
+            Eps_AstMark mark = EpsAst_Mark(ast);
+            Eps_AstIndex stmt = EpsParser_Next(parser);
+            bool keep;
+
+            if (stmt == EPS_AST_NONE || EpsErr_WasError())
+                break;
+
+            EpsOptimizer_Next(optimizer, stmt);
+
+            // functions are referred to by the global frame, other
+            // statements are dropped as soon as they are done
+            size_t globals = EpsResolver_Next(resolver, stmt, &keep);
+
+            if (EpsErr_WasError())
+                break;
+
+            EpsTypeChecker_Next(checker, stmt);
+
+            if (EpsErr_WasError())
+                break;
+
+            Eps_EnvResize(env, globals);
+            run_global(ast, env, stmt);
+
+            if (keep)
+                EpsParser_KeepSource(parser);
+            else
+                EpsAst_Rewind(ast, mark);
+
+            // output shows up even when stdout is a pipe
+            fflush(stdout);
+        }
     }
+
+    EpsErr_SetRuntimeHandler(NULL);
+    Eps_EnvDestroy(env);
+    EpsTypeChecker_Destroy(checker);
+    EpsOptimizer_Destroy(optimizer);
+    EpsResolver_Destroy(resolver);
 }
@@ -0,0 +1,552 @@
+#include "interpreter/resolver.h"
+#include "interpreter/enviroment.h"
+#include "parser.h"
+#include "ast.h"
+#include "core/ds/dict.h"
+#include "core/errors.h"
+#include "core/memory.h"
+#include "core/debug_macros.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdint.h>
+
+typedef enum {
+    BIND_VAR = 0,
+    BIND_CONST,
+    BIND_FUNC,
+    BIND_FORWARD, // used by a function before it is defined
+} BindingKind;
+
+// Warning: do not change the order
+static const char *binding_kind_strings[] = {
+    "variable",
+    "constant",
+    "function",
+    "name"
+};
+
+typedef struct {
+    Eps_Symbol  *name;
+    BindingKind  kind;
+    Eps_AstIndex decl; // declaring statement, EPS_AST_NONE for parameters
+} Binding;
+
+// Binding slot is its index in the scope offset by the scope base.
+// Functions and top-level blocks own a frame, nested blocks take
+// the slots of the frame following the ones of the enclosing scope.
+typedef struct scope_t {
+    struct scope_t *enclosing;
+    struct scope_t *frame; // scope owning the frame
+    Binding        *bindings;
+    size_t          length;
+    size_t          capacity;
+    size_t          base;  // first slot of the scope in the frame
+    size_t          size;  // number of slots in the frame, frame owner only
+    EpsDict        *names; // name -> index+1, global scope only
+} Scope;
+
+typedef struct Eps_Resolver {
+    Eps_Ast *ast;
+    Scope *current;
+    Scope  globals;
+    size_t functions; // number of enclosing function bodies
+    bool   hoisted;   // whether globals are declared up front
+    Eps_AstIndex toplevel; // top-level statement being resolved
+    bool   global_func; // whether the statement bound a global function
+} Resolver;
+
+static void
+resolve_stmt(Resolver *self, Eps_AstIndex stmt);
+
+static void
+resolve_expr(Resolver *self, Eps_AstIndex expr);
+
+// * - Errors -
+
+static void
+name_error(Eps_SrcSpan span, const char format[], ...)
+{
+    ERR_INSTANCE_INIT_BUFFER();
+
+    EpsErr_Raise(span, "Name Error", buffer);
+}
+
+// * - Scopes -
+
+static void
+begin_scope(Resolver *self, Scope *scope, bool frame)
+{
+    Scope *enclosing = self->current;
+
+    scope->enclosing = enclosing;
+    scope->frame = frame || enclosing == NULL ? scope : enclosing->frame;
+    scope->bindings = NULL;
+    scope->length = 0;
+    scope->capacity = 0;
+    scope->base = scope->frame == scope
+        ? 0
+        : enclosing->base + enclosing->length;
+    scope->size = 0;
+    // global scope may hold thousands of names, block scopes
+    // are small enough to be scanned
+    scope->names = self->current == NULL ? EpsDict_Create() : NULL;
+
+    self->current = scope;
+}
+
+// Ends current scope, returns size of the frame it owns
+// or the number of slots it takes in the enclosing frame
+static size_t
+end_scope(Resolver *self)
+{
+    Scope *scope = self->current;
+    size_t size = scope->frame == scope ? scope->size : scope->length;
+
+    if (scope->names != NULL)
+        EpsDict_Destroy(scope->names, NULL);
+
+    EpsMem_Free(scope->bindings);
+    self->current = scope->enclosing;
+
+    return size;
+}
+
+static bool
+is_global_scope(Resolver *self)
+{
+    return self->current->enclosing == NULL;
+}
+
+static Binding *
+scope_find(Scope *scope, Eps_Symbol *name)
+{
+    size_t i;
+
+    if (scope->names != NULL) {
+        uintptr_t slot = (uintptr_t)EpsDict_Get(scope->names, name);
+
+        return slot ? &scope->bindings[slot-1] : NULL;
+    }
+
+    for (i = 0; i < scope->length; i++) {
+        if (scope->bindings[i].name == name)
+            return &scope->bindings[i];
+    }
+
+    return NULL;
+}
+
+// Adds binding to the 'scope', returns its slot
+static size_t
+scope_add(Scope *scope, Eps_Symbol *name, BindingKind kind, Eps_AstIndex decl)
+{
+    size_t slot = scope->base + scope->length;
+    Binding *b;
+
+    if (scope->length == scope->capacity) {
+        scope->capacity = scope->capacity ? scope->capacity*2 : 8;
+        scope->bindings = EpsMem_Realloc(
+            scope->bindings,
+            sizeof(Binding)*scope->capacity
+        );
+    }
+
+    b = &scope->bindings[scope->length];
+    b->name = name;
+    b->kind = kind;
+    b->decl = decl;
+
+    if (scope->names != NULL)
+        EpsDict_Set(scope->names, b->name, (void *)(uintptr_t)(scope->length+1));
+
+    if (slot >= scope->frame->size)
+        scope->frame->size = slot + 1;
+
+    scope->length++;
+
+    return slot;
+}
+
+// Declares name in the current scope, returns its slot
+static size_t
+declare(Resolver *self, Eps_Identifier *name, BindingKind kind, Eps_AstIndex decl)
+{
+    Binding *b = scope_find(self->current, name->name);
+
+    if (b != NULL) {
+        name_error(
+            name->span,
+            "%s '%s' is already defined",
+            binding_kind_strings[kind],
+            name->name->str
+        );
+
+        // the first definition keeps the name, the error stops the program
+        return self->current->base + (b - self->current->bindings);
+    }
+
+    return scope_add(self->current, name->name, kind, decl);
+}
+
+// Binds declaration to the slot in the current scope,
+// global declarations may have been hoisted or used already
+static size_t
+bind_decl(Resolver *self, Eps_Identifier *name, BindingKind kind, Eps_AstIndex decl)
+{
+    if (is_global_scope(self)) {
+        Binding *b = scope_find(self->current, name->name);
+
+        // top-level declarations are hoisted, duplicates are reported there
+        if (self->hoisted && decl == self->toplevel)
+            return self->current->base + (b - self->current->bindings);
+
+        if (!self->hoisted && b != NULL && b->kind == BIND_FORWARD) {
+            b->kind = kind;
+            b->decl = decl;
+
+            return self->current->base + (b - self->current->bindings);
+        }
+    }
+
+    return declare(self, name, kind, decl);
+}
+
+// Finds innermost binding named 'name', stores where it lives,
+// depth is the number of frames between the current and its one
+static Binding *
+lookup(Resolver *self, Eps_Symbol *name, uint32_t *depth, uint32_t *slot)
+{
+    Scope *scope = self->current;
+    uint32_t d = 0;
+
+    for (; scope != NULL; scope = scope->enclosing) {
+        Binding *b = scope_find(scope, name);
+
+        if (b != NULL) {
+            *depth = scope->frame->enclosing == NULL ? EPS_ENV_GLOBAL_DEPTH : d;
+            *slot = scope->base + (b - scope->bindings);
+
+            return b;
+        }
+
+        if (scope->frame == scope)
+            d++;
+    }
+
+    // without hoisting, function may refer to a global defined later
+    if (!self->hoisted && self->functions > 0) {
+        *depth = EPS_ENV_GLOBAL_DEPTH;
+        *slot = scope_add(&self->globals, name, BIND_FORWARD, EPS_AST_NONE);
+
+        return &self->globals.bindings[*slot];
+    }
+
+    return NULL;
+}
+
+// Declare top-level names up front, so functions
+// may refer to globals defined after them
+static void
+hoist_globals(Resolver *self, Eps_AstList stmts)
+{
+    uint32_t i;
+
+    for (i = 0; i < stmts.length; i++) {
+        Eps_AstIndex index = EpsAst_ListGet(self->ast, stmts, i);
+        Eps_Statement *stmt = EpsAst_Stmt(self->ast, index);
+
+        switch (stmt->type) {
+            case S_FUNC:
+                declare(self, &stmt->func.identifier, BIND_FUNC, index);
+            break;
+            case S_DEFINE:
+                declare(self, &stmt->define.identifier, BIND_VAR, index);
+            break;
+            case S_CONST:
+                declare(self, &stmt->define.identifier, BIND_CONST, index);
+            break;
+            default: break;
+        }
+    }
+}
+
+// * - Expressions -
+
+static void
+resolve_call(Resolver *self, Eps_Call *call)
+{
+    Binding *b = lookup(self, call->identifier.name, &call->depth, &call->slot);
+    uint32_t i;
+
+    if (b == NULL) {
+        name_error(
+            call->identifier.span,
+            "call undefined function '%s'",
+            call->identifier.name->str
+        );
+    } else if (b->kind != BIND_FUNC && b->kind != BIND_FORWARD) {
+        name_error(
+            call->identifier.span,
+            "'%s' is not a function",
+            call->identifier.name->str
+        );
+    }
+
+    for (i = 0; i < call->args.length; i++) {
+        resolve_expr(self, EpsAst_ListGet(self->ast, call->args, i));
+    }
+}
+
+static void
+resolve_primary(Resolver *self, Eps_Expression *node)
+{
+    switch (node->primary) {
+        case PRIMARY_LIT: break;
+        case PRIMARY_PAREN:
+            resolve_expr(self, node->expr);
+        break;
+        case PRIMARY_CALL:
+            resolve_call(self, EpsAst_Call(self->ast, node->call));
+        break;
+        case PRIMARY_ID:
+        {
+            Binding *b = lookup(
+                self,
+                node->var.name,
+                &node->var.depth,
+                &node->var.slot
+            );
+
+            if (b == NULL) {
+                name_error(
+                    node->span,
+                    "reference to undefined name '%s'",
+                    node->var.name->str
+                );
+            } else if (b->kind == BIND_FUNC) {
+                name_error(
+                    node->span,
+                    "function '%s' cannot be used as a value",
+                    node->var.name->str
+                );
+            }
+        } break;
+    }
+}
+
+static void
+resolve_expr(Resolver *self, Eps_AstIndex index)
+{
+    Eps_Expression *expr = EpsAst_Expr(self->ast, index);
+
+    switch (expr->type) {
+        case NODE_TERNARY:
+            resolve_expr(self, expr->ternary.cond);
+            resolve_expr(self, expr->ternary.left);
+            resolve_expr(self, expr->ternary.right);
+        break;
+        case NODE_BIN:
+            resolve_expr(self, expr->binary.left);
+            resolve_expr(self, expr->binary.right);
+        break;
+        case NODE_UNARY:
+            resolve_expr(self, expr->unary.right);
+        break;
+        case NODE_PRIMARY:
+            resolve_primary(self, expr);
+        break;
+    }
+}
+
+// * - Statements -
+
+static void
+resolve_group(Resolver *self, Eps_StatementGroup *group)
+{
+    Scope scope;
+    uint32_t i;
+
+    // blocks share frame of the function or top-level block
+    begin_scope(self, &scope, is_global_scope(self));
+
+    for (i = 0; i < group->stmts.length; i++) {
+        resolve_stmt(self, EpsAst_ListGet(self->ast, group->stmts, i));
+    }
+
+    group->frame = scope.frame == &scope;
+    group->base = scope.base;
+    group->scope_size = end_scope(self);
+}
+
+static void
+resolve_func(Resolver *self, Eps_AstIndex index, Eps_StatementFunc *func)
+{
+    Scope scope;
+    uint32_t i;
+
+    func->slot = bind_decl(self, &func->identifier, BIND_FUNC, index);
+
+    if (is_global_scope(self))
+        self->global_func = true;
+
+    // parameters take the first slots of the function frame
+    begin_scope(self, &scope, true);
+
+    for (i = 0; i < func->params.length; i++) {
+        Eps_Param *param = EpsAst_Param(self->ast, func->params, i);
+
+        declare(self, &param->identifier, BIND_VAR, EPS_AST_NONE);
+    }
+
+    self->functions++;
+    resolve_stmt(self, func->body);
+    self->functions--;
+
+    func->scope_size = end_scope(self);
+}
+
+static void
+resolve_define(Resolver *self, Eps_AstIndex index, Eps_StatementVar *stmt,
+                                                   BindingKind kind)
+{
+    // initializer can't see the variable it defines
+    resolve_expr(self, stmt->expr);
+
+    stmt->depth = 0;
+    stmt->slot = bind_decl(self, &stmt->identifier, kind, index);
+}
+
+static void
+resolve_assign(Resolver *self, Eps_StatementVar *stmt)
+{
+    Binding *b = lookup(
+        self,
+        stmt->identifier.name,
+        &stmt->depth,
+        &stmt->slot
+    );
+
+    resolve_expr(self, stmt->expr);
+
+    if (b == NULL) {
+        name_error(
+            stmt->identifier.span,
+            "variable '%s' is not defined",
+            stmt->identifier.name->str
+        );
+    } else if (b->kind == BIND_CONST) {
+        name_error(
+            stmt->identifier.span,
+            "cannot assign value to const '%s'",
+            stmt->identifier.name->str
+        );
+    } else if (b->kind == BIND_FUNC) {
+        name_error(
+            stmt->identifier.span,
+            "'%s' is not a variable",
+            stmt->identifier.name->str
+        );
+    }
+}
+
+static void
+resolve_stmt(Resolver *self, Eps_AstIndex index)
+{
+    Eps_Statement *stmt = EpsAst_Stmt(self->ast, index);
+
+    switch (stmt->type) {
+        case S_EXPR:
+            resolve_expr(self, stmt->expr.expr);
+        break;
+        case S_GROUP:
+            resolve_group(self, &stmt->group);
+        break;
+        case S_OUTPUT:
+            resolve_expr(self, stmt->output.expr);
+        break;
+        case S_IF:
+            resolve_expr(self, stmt->conditional.cond);
+            resolve_stmt(self, stmt->conditional.body);
+
+            if (stmt->conditional._else != EPS_AST_NONE)
+                resolve_stmt(self, stmt->conditional._else);
+        break;
+        case S_FUNC:
+            resolve_func(self, index, &stmt->func);
+        break;
+        case S_RETURN:
+            if (stmt->ret.expr != EPS_AST_NONE)
+                resolve_expr(self, stmt->ret.expr);
+        break;
+        case S_CONST:
+            resolve_define(self, index, &stmt->define, BIND_CONST);
+        break;
+        case S_DEFINE:
+            resolve_define(self, index, &stmt->define, BIND_VAR);
+        break;
+        case S_ASSIGN:
+            resolve_assign(self, &stmt->assign);
+        break;
+    }
+}
+
+size_t
+Eps_Resolve(Eps_Ast *ast)
+{
+    _DEBUG("--------------- RESOLVER ---------------\n");
+
+    Resolver resolver = {
+        .ast = ast,
+        .current = NULL,
+        .functions = 0,
+        .hoisted = true,
+        .toplevel = EPS_AST_NONE,
+        .global_func = false
+    };
+    uint32_t i;
+
+    begin_scope(&resolver, &resolver.globals, true);
+    hoist_globals(&resolver, ast->program);
+
+    for (i = 0; i < ast->program.length; i++) {
+        resolver.toplevel = EpsAst_ListGet(ast, ast->program, i);
+        resolve_stmt(&resolver, resolver.toplevel);
+    }
+
+    return end_scope(&resolver);
+}
+
+Eps_Resolver *
+EpsResolver_Create(Eps_Ast *ast)
+{
+    Eps_Resolver *self = EpsMem_Alloc(sizeof(Eps_Resolver));
+
+    self->ast = ast;
+    self->current = NULL;
+    self->functions = 0;
+    self->hoisted = false;
+    self->toplevel = EPS_AST_NONE;
+    self->global_func = false;
+    begin_scope(self, &self->globals, true);
+
+    return self;
+}
+
+void
+EpsResolver_Destroy(Eps_Resolver *self)
+{
+    end_scope(self);
+    EpsMem_Free(self);
+}
+
+size_t
+EpsResolver_Next(Eps_Resolver *self, Eps_AstIndex stmt, bool *global_func)
+{
+    _DEBUG("--------------- RESOLVER ---------------\n");
+
+    self->global_func = false;
+    resolve_stmt(self, stmt);
+    *global_func = self->global_func;
+
+    return self->globals.length;
+}
@@ -2,11 +2,33 @@
 #include "core/errors.h"
 #include <stdio.h>
 #include <stdarg.h>
+#include <stdlib.h>
+
+static jmp_buf *runtime_handler = NULL;
+
+void
+EpsErr_RuntimeError(Eps_SrcSpan span, char *format, ...)
+{
+    ERR_INSTANCE_INIT_BUFFER();
+
+    EpsErr_Raise(span, "Runtime Error", buffer);
+}
 
 void
-EpsErr_RuntimeError(Eps_LexState *ls, char *format, ...)
+EpsErr_RuntimeThrow(Eps_SrcSpan span, char *format, ...)
 {
     ERR_INSTANCE_INIT_BUFFER();
 
-    EpsErr_Raise(ls, "Runtime Error", buffer);
+    EpsErr_Raise(span, "Runtime Error", buffer);
+
+    if (runtime_handler == NULL)
+        exit(1);
+
+    longjmp(*runtime_handler, 1);
+}
+
+void
+EpsErr_SetRuntimeHandler(jmp_buf *handler)
+{
+    runtime_handler = handler;
 }
@@ -4,290 +4,296 @@
 #include "interpreter/runtime_errors.h"
 #include "core/debug_macros.h"
 #include "core/errors.h"
-#include "core/memory.h"
 #include <stdarg.h>
 
 // * - Utils -
-static StmtResult *
-stmt_res_create(void)
+static StmtResult
+stmt_res_none(void)
 {
-    return EpsMem_Alloc(sizeof(StmtResult));
+    StmtResult stmt_res = { .type = STMT_RES_NONE };
+
+    return stmt_res;
 }
 
-static StmtResult *
-stmt_res_return(Eps_Object *val, Eps_StatementReturn *stmt)
+static StmtResult
+stmt_res_return(Eps_Object val, Eps_StatementReturn *stmt)
 {
-    StmtResult *stmt_res = stmt_res_create();
+    StmtResult stmt_res = {
+        .type = STMT_RES_RET,
+        .ret = { .stmt = stmt, .val = val }
+    };
+
+    return stmt_res;
+}
 
-    stmt_res->type = STMT_RES_RET;
-    stmt_res->ret.val = val;
-    stmt_res->ret.stmt = stmt;
+static StmtResult
+stmt_res_tail(
+    const Eps_StatementFunc *func,
+    Eps_Env *frame,
+    Eps_StatementReturn *stmt
+)
+{
+    StmtResult stmt_res = {
+        .type = STMT_RES_TAIL,
+        .tail = { .stmt = stmt, .func = func, .frame = *frame }
+    };
 
     return stmt_res;
 }
 
 // * - Running Statements -
-static StmtResult *
-visit_expr_stmt(Eps_Env *env, Eps_StatementExpr *stmt)
+static StmtResult
+visit_expr_stmt(const Eps_Ast *ast, Eps_Env *env, Eps_StatementExpr *stmt)
 {
-    Eps_EvalExpr(env, stmt->expr);
+    Eps_Object val = Eps_EvalExpr(ast, env, stmt->expr);
+
+    EpsObject_Destroy(&val);
 
-    return NULL;
+    return stmt_res_none();
 }
 
-static StmtResult *
-visit_group(Eps_Env *env, Eps_StatementGroup *stmt)
+static StmtResult
+visit_group(const Eps_Ast *ast, Eps_Env *env, Eps_StatementGroup *stmt)
 {
-    EpsList_Node *node = stmt->head;
-    Eps_Env *block_env = Eps_EnvCreate();
-    StmtResult *res;
-
-    block_env->scope = SCOPE_BLOCK;
-    block_env->enclosing = env;
+    Eps_Env frame;
+    Eps_Env *block_env = env;
+    StmtResult res = stmt_res_none();
+    uint32_t i;
+
+    // top-level blocks push their own frame, other blocks
+    // take the slots of the enclosing frame
+    if (stmt->frame) {
+        if (!Eps_EnvPush(&frame, env, SCOPE_BLOCK, stmt->scope_size))
+            EpsErr_RuntimeThrow(stmt->brace, "stack overflow");
+
+        block_env = &frame;
+    }
 
     // while we didn't found return statement
-    while (node != NULL) {
-        res = Eps_RunStatement(block_env, node->data);
-        node = node->next; // keep moving on
-
-        if (res != NULL) return res;
+    for (i = 0; i < stmt->stmts.length && res.type == STMT_RES_NONE; i++) {
+        res = Eps_RunStatement(
+            ast,
+            block_env,
+            EpsAst_ListGet(ast, stmt->stmts, i)
+        );
     }
 
-    // Eps_EnvDestroy(block_env);
+    if (stmt->frame) {
+        Eps_EnvPop(&frame);
+    } else {
+        Eps_EnvClear(env, stmt->base, stmt->base + stmt->scope_size);
+    }
 
-    return NULL;
+    return res;
 }
 
-static StmtResult *
-visit_if(Eps_Env *env, Eps_StatementConditional *stmt)
+static StmtResult
+visit_if(const Eps_Ast *ast, Eps_Env *env, Eps_StatementConditional *stmt)
 {
-    Eps_Object *cond = Eps_EvalExpr(env, stmt->cond);
+    Eps_Expression *cond_node = EpsAst_Expr(ast, stmt->cond);
+    Eps_Object cond = Eps_EvalExpr(ast, env, stmt->cond);
 
-    if (cond->type != OBJ_BOOL) {
-        EpsErr_RuntimeError(
-            &stmt->cond->ls,
+    // conditions of the unknown type are checked at runtime
+    if (cond_node->value_type == OBJ_ANY && cond.type != OBJ_BOOL) {
+        const char *type = EpsDbg_GetObjectTypeString(cond.type);
+
+        EpsObject_Destroy(&cond);
+        EpsErr_RuntimeThrow(
+            cond_node->span,
             "invalid condition type '%s'",
-            EpsDbg_GetObjectTypeString(cond->type)
+            type
         );
-
-        EpsObject_Destroy(cond);
-        return NULL;
     }
 
-
-    if (*(double *)cond->value) {
-        return Eps_RunStatement(env, stmt->body);
-    } else if (stmt->_else != NULL) {
-        return Eps_RunStatement(env, stmt->_else);
+    if (cond.boolean) {
+        return Eps_RunStatement(ast, env, stmt->body);
+    } else if (stmt->_else != EPS_AST_NONE) {
+        return Eps_RunStatement(ast, env, stmt->_else);
     }
 
-    EpsObject_Destroy(cond);
-    return NULL;
+    return stmt_res_none();
 }
 
-static StmtResult *
-visit_output(Eps_Env *env, Eps_StatementOutput *stmt)
+static StmtResult
+visit_output(const Eps_Ast *ast, Eps_Env *env, Eps_StatementOutput *stmt)
 {
-    Eps_Object *val = Eps_EvalExpr(env, stmt->expr);
+    Eps_Object val = Eps_EvalExpr(ast, env, stmt->expr);
 
-    switch (val->type) {
+    switch (val.type) {
         case OBJ_STRING:
-            printf("%s\n", (char *)val->value);
+            printf("%s\n", val.string->chars);
         break;
         case OBJ_REAL:
-            printf("%f\n", *(double *)val->value);
+            printf("%f\n", val.real);
         break;
         case OBJ_BOOL:
-            printf(
-                "%s\n",
-                (char *)EpsObject_ToString(val)->value
-            );
+            printf("%s\n", val.boolean ? "true" : "false");
         break;
-        case OBJ_VOID:
-            EpsErr_RuntimeError(
-                &stmt->expr->ls,
-                "cannot output value type of 'void'"
+        default:
+            EpsErr_RuntimeThrow(
+                EpsAst_Expr(ast, stmt->expr)->span,
+                "cannot output value type of '%s'",
+                EpsDbg_GetObjectTypeString(val.type)
             );
     }
 
-    EpsObject_Destroy(val);
+    EpsObject_Destroy(&val);
 
-    return NULL;
+    return stmt_res_none();
 }
 
-static StmtResult *
-visit_return(Eps_Env *env, Eps_StatementReturn *stmt)
+static StmtResult
+visit_return(const Eps_Ast *ast, Eps_Env *env, Eps_StatementReturn *stmt)
 {
-    // Check if there is an expression in return statement
-    if (stmt->expr != NULL)
-        return stmt_res_return(Eps_EvalExpr(env, stmt->expr), stmt);
+    Eps_Object val = { .type = OBJ_VOID };
+    const Eps_StatementFunc *callee;
+    Eps_Env next;
+
+    // bare return stops the function with no value
+    if (stmt->expr == EPS_AST_NONE)
+        return stmt_res_return(val, stmt);
+
+    // calls in tail position are left to the function
+    // returning their value, so they reuse its frame. Arguments
+    // are evaluated here, before the blocks sharing the frame
+    // release their slots.
+    if (env->scope != SCOPE_FUNC)
+        return stmt_res_return(Eps_EvalExpr(ast, env, stmt->expr), stmt);
+
+    callee = Eps_EvalTail(ast, env, stmt->expr, &val, &next);
 
-    return NULL;
+    if (callee != NULL)
+        return stmt_res_tail(callee, &next, stmt);
+
+    return stmt_res_return(val, stmt);
 }
 
-static StmtResult *
-visit_func(Eps_Env *env, Eps_StatementFunc *stmt)
+static StmtResult
+visit_func(const Eps_Ast *ast, Eps_Env *env, Eps_AstIndex index)
 {
-    bool already_defined = Eps_EnvGet(env, stmt->identifier->lexeme) != NULL;
+    Eps_StatementFunc *stmt = &EpsAst_Stmt(ast, index)->func;
+    Eps_Object func = { .type = OBJ_FUNC, .func = index };
 
-    if (!already_defined) {
-        Eps_EnvDefine(
-            env,
-            stmt->identifier->lexeme,
-            stmt
-        );
-    } else {
-        EpsErr_RuntimeError(
-            &stmt->identifier->ls,
-            "function '%s' is already defined",
-            stmt->identifier->lexeme
-        );
-    }
+    Eps_EnvDefine(env, stmt->slot, func);
 
-    return NULL;
+    return stmt_res_none();
 }
 
-static StmtResult *
-visit_const(Eps_Env *env, Eps_StatementVar *stmt)
+static StmtResult
+visit_const(const Eps_Ast *ast, Eps_Env *env, Eps_StatementVar *stmt)
 {
-    if (!Eps_EnvGetLocal(env, stmt->identifier->lexeme)) {
-        Eps_Object *val = Eps_EvalExpr(env, stmt->expr);
-
-        // if const type matches value type
-        if(val->type == stmt->type) {
-            Eps_EnvDefine(
-                env,
-                stmt->identifier->lexeme,
-                val
-            );
-        } else {
-            EpsErr_RuntimeError(
-                &stmt->identifier->ls,
-                "cannot assign value type '%s' to const type '%s'",
-                EpsDbg_GetObjectTypeString(val->type),
-                EpsDbg_GetObjectTypeString(stmt->type)
-            );
-        }
+    Eps_Object val = Eps_EvalExpr(ast, env, stmt->expr);
+
+    // if const type matches value type
+    if (EpsAst_Expr(ast, stmt->expr)->value_type != OBJ_ANY
+            || val.type == stmt->type) {
+        Eps_EnvDefine(env, stmt->slot, val);
     } else {
-        EpsErr_RuntimeError(
-            &stmt->identifier->ls,
-            "constant '%s' is already defined",
-            stmt->identifier->lexeme
+        const char *type = EpsDbg_GetObjectTypeString(val.type);
+
+        EpsObject_Destroy(&val);
+        EpsErr_RuntimeThrow(
+            stmt->identifier.span,
+            "cannot assign value type '%s' to const type '%s'",
+            type,
+            EpsDbg_GetObjectTypeString(stmt->type)
         );
     }
 
-    return NULL;
+    return stmt_res_none();
 }
 
-static StmtResult *
-visit_define(Eps_Env *env, Eps_StatementVar *stmt)
+static StmtResult
+visit_define(const Eps_Ast *ast, Eps_Env *env, Eps_StatementVar *stmt)
 {
-    Eps_Object *temp = Eps_EnvGetLocal(env, stmt->identifier->lexeme);
+    Eps_Object val = Eps_EvalExpr(ast, env, stmt->expr);
 
-    if (temp == NULL) {
-        Eps_Object *val = Eps_EvalExpr(env, stmt->expr);
-
-        // if variable type matches value type
-        if(val->type == stmt->type) {
-            Eps_EnvDefine(
-                env,
-                stmt->identifier->lexeme,
-                val
-            );
-        } else {
-            EpsErr_RuntimeError(
-                &stmt->identifier->ls,
-                "cannot assign value type '%s' to variable type '%s'",
-                EpsDbg_GetObjectTypeString(val->type),
-                EpsDbg_GetObjectTypeString(stmt->type)
-            );
-        }
+    // if variable type matches value type
+    if (EpsAst_Expr(ast, stmt->expr)->value_type != OBJ_ANY
+            || val.type == stmt->type) {
+        Eps_EnvDefine(env, stmt->slot, val);
     } else {
-        EpsErr_RuntimeError(
-            &stmt->identifier->ls,
-            "varable '%s' is already defined",
-            stmt->identifier->lexeme
+        const char *type = EpsDbg_GetObjectTypeString(val.type);
+
+        EpsObject_Destroy(&val);
+        EpsErr_RuntimeThrow(
+            stmt->identifier.span,
+            "cannot assign value type '%s' to variable type '%s'",
+            type,
+            EpsDbg_GetObjectTypeString(stmt->type)
         );
     }
 
-    return NULL;
+    return stmt_res_none();
 }
 
-static StmtResult *
-visit_assign(Eps_Env *env, Eps_StatementVar *stmt)
+static StmtResult
+visit_assign(const Eps_Ast *ast, Eps_Env *env, Eps_StatementVar *stmt)
 {
-    Eps_Object *ref_val = Eps_EnvGet(env, stmt->identifier->lexeme);
-    Eps_Object *new_val = Eps_EvalExpr(env, stmt->expr);
-    bool is_impicit = ref_val == NULL;
-
-    // check if implicit declaration
-    if (is_impicit) {
-        EpsErr_RuntimeError(
-            &stmt->identifier->ls,
-            "varable '%s' is not defined",
-            stmt->identifier->lexeme
+    Eps_Object *ref_val = Eps_EnvGet(env, stmt->depth, stmt->slot);
+    Eps_Object new_val = Eps_EvalExpr(ast, env, stmt->expr);
+
+    // global variable may be not defined yet
+    if (ref_val->type == OBJ_UNDEFINED) {
+        EpsObject_Destroy(&new_val);
+        EpsErr_RuntimeThrow(
+            stmt->identifier.span,
+            "variable '%s' is not defined",
+            stmt->identifier.name->str
         );
-
-        return NULL;
     }
 
-    // check if types matches
-    if (ref_val->type != new_val->type) {
-        EpsErr_RuntimeError(
-            &stmt->identifier->ls,
+    // check if types matches, unless both are known up front
+    if ((stmt->type == OBJ_ANY
+            || EpsAst_Expr(ast, stmt->expr)->value_type == OBJ_ANY)
+            && ref_val->type != new_val.type) {
+        const char *type = EpsDbg_GetObjectTypeString(new_val.type);
+
+        EpsObject_Destroy(&new_val);
+        EpsErr_RuntimeThrow(
+            stmt->identifier.span,
             "cannot assign '%s' to variable type '%s'",
-            EpsDbg_GetObjectTypeString(new_val->type),
+            type,
             EpsDbg_GetObjectTypeString(ref_val->type)
         );
-
-        return NULL;
-    }
-
-    // if reference value is not mutable
-    if(ref_val->mut == false) {
-        EpsErr_RuntimeError(
-            &stmt->identifier->ls,
-            "cannot assign value to const '%s'",
-            stmt->identifier->lexeme
-        );
-
-        return NULL;
     }
 
     EpsObject_Destroy(ref_val);
-    *ref_val = *new_val;
+    *ref_val = new_val;
 
-    return NULL;
+    return stmt_res_none();
 }
 
-StmtResult *
-Eps_RunStatement(Eps_Env *env, Eps_Statement *stmt)
+StmtResult
+Eps_RunStatement(const Eps_Ast *ast, Eps_Env *env, Eps_AstIndex index)
 {
+    Eps_Statement *stmt = EpsAst_Stmt(ast, index);
+
 #ifdef EPS_DBG
     _DEBUG("STATEMENT: %s\n", _EpsDbg_GetStmtTypeString(stmt->type));
 #endif
 
     switch (stmt->type) {
         case S_EXPR:
-            return visit_expr_stmt(env, stmt->expr);
+            return visit_expr_stmt(ast, env, &stmt->expr);
         case S_GROUP:
-            return visit_group(env, stmt->group);
+            return visit_group(ast, env, &stmt->group);
         case S_OUTPUT:
-            return visit_output(env, stmt->output);
+            return visit_output(ast, env, &stmt->output);
         case S_IF:
-            return visit_if(env, stmt->conditional);
+            return visit_if(ast, env, &stmt->conditional);
         case S_FUNC:
-            return visit_func(env, stmt->func);
+            return visit_func(ast, env, index);
         case S_RETURN:
-            return visit_return(env, stmt->ret);
+            return visit_return(ast, env, &stmt->ret);
         case S_CONST:
-            return visit_const(env, stmt->define);
+            return visit_const(ast, env, &stmt->define);
         case S_DEFINE:
-            return visit_define(env, stmt->define);
+            return visit_define(ast, env, &stmt->define);
         case S_ASSIGN:
-            return visit_assign(env, stmt->assign);
+            return visit_assign(ast, env, &stmt->assign);
         default: break;
     }
 
-    return NULL;
+    return stmt_res_none();
 }
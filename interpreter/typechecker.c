@@ -0,0 +1,615 @@
+#include "interpreter/typechecker.h"
+#include "interpreter/enviroment.h"
+#include "parser.h"
+#include "ast.h"
+#include "core/errors.h"
+#include "core/memory.h"
+#include "core/debug_macros.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdint.h>
+
+// Expressions which type is known are checked up front, OBJ_ANY
+// marks expressions the interpreter has to check when it runs them
+
+// What is known about the scope slot
+typedef struct {
+    Eps_ObjectType type; // declared type, OBJ_ANY if unknown
+    Eps_AstIndex   func; // statement of the function bound to the slot,
+                         // EPS_AST_NONE if there is no function
+} Slot;
+
+// Scopes mirror the frames of the resolver, so slots are
+// found by the depth and slot the resolver has stored
+typedef struct scope_t {
+    struct scope_t *enclosing;
+    Slot           *slots;
+} Scope;
+
+typedef struct Eps_TypeChecker {
+    Eps_Ast *ast;
+    Scope   *current; // innermost local scope, NULL at the top level
+    Slot    *globals;
+    size_t   globals_length;
+    const Eps_StatementFunc *func; // innermost enclosing function
+} Checker;
+
+static void
+check_stmt(Checker *self, Eps_AstIndex stmt);
+
+static Eps_ObjectType
+check_expr(Checker *self, Eps_AstIndex expr);
+
+// * - Errors -
+
+static void
+type_error(Eps_SrcSpan span, const char format[], ...)
+{
+    ERR_INSTANCE_INIT_BUFFER();
+
+    EpsErr_Raise(span, "Type Error", buffer);
+}
+
+static const char *
+type_string(Eps_ObjectType type)
+{
+    return EpsDbg_GetObjectTypeString(type);
+}
+
+// * - Scopes -
+
+static Slot *
+slots_create(size_t size)
+{
+    Slot *slots = size ? EpsMem_Alloc(sizeof(Slot)*size) : NULL;
+    size_t i;
+
+    for (i = 0; i < size; i++) {
+        slots[i].type = OBJ_ANY;
+        slots[i].func = EPS_AST_NONE;
+    }
+
+    return slots;
+}
+
+static void
+begin_scope(Checker *self, Scope *scope, size_t size)
+{
+    scope->enclosing = self->current;
+    scope->slots = slots_create(size);
+    self->current = scope;
+}
+
+static void
+end_scope(Checker *self)
+{
+    EpsMem_Free(self->current->slots);
+    self->current = self->current->enclosing;
+}
+
+// Returns global slot, the global scope grows as names are resolved
+static Slot *
+global_slot(Checker *self, uint32_t slot)
+{
+    if (slot >= self->globals_length) {
+        size_t length = self->globals_length ? self->globals_length : 8;
+        size_t i;
+
+        while (length <= slot) length *= 2;
+
+        self->globals = EpsMem_Realloc(self->globals, sizeof(Slot)*length);
+
+        for (i = self->globals_length; i < length; i++) {
+            self->globals[i].type = OBJ_ANY;
+            self->globals[i].func = EPS_AST_NONE;
+        }
+
+        self->globals_length = length;
+    }
+
+    return &self->globals[slot];
+}
+
+static Slot *
+lookup(Checker *self, uint32_t depth, uint32_t slot)
+{
+    Scope *scope = self->current;
+
+    if (depth == EPS_ENV_GLOBAL_DEPTH)
+        return global_slot(self, slot);
+
+    while (depth--) {
+        scope = scope->enclosing;
+    }
+
+    return &scope->slots[slot];
+}
+
+// Declares slot of the current scope
+static void
+declare(Checker *self, uint32_t slot, Eps_ObjectType type, Eps_AstIndex func)
+{
+    Slot *s = lookup(self, self->current ? 0 : EPS_ENV_GLOBAL_DEPTH, slot);
+
+    s->type = type;
+    s->func = func;
+}
+
+// Declare top-level names up front, as the resolver does
+static void
+hoist_globals(Checker *self, Eps_AstList stmts)
+{
+    uint32_t i;
+
+    for (i = 0; i < stmts.length; i++) {
+        Eps_AstIndex index = EpsAst_ListGet(self->ast, stmts, i);
+        Eps_Statement *stmt = EpsAst_Stmt(self->ast, index);
+
+        switch (stmt->type) {
+            case S_FUNC:
+                declare(self, stmt->func.slot, OBJ_FUNC, index);
+            break;
+            case S_DEFINE:
+            case S_CONST:
+                declare(
+                    self,
+                    stmt->define.slot,
+                    stmt->define.type,
+                    EPS_AST_NONE
+                );
+            break;
+            default: break;
+        }
+    }
+}
+
+// * - Functions -
+
+// Whether statement returns a value on every path
+static bool
+always_returns(Checker *self, Eps_AstIndex index)
+{
+    Eps_Statement *stmt = EpsAst_Stmt(self->ast, index);
+    uint32_t i;
+
+    switch (stmt->type) {
+        case S_RETURN:
+            return stmt->ret.expr != EPS_AST_NONE;
+        case S_GROUP:
+        {
+            for (i = 0; i < stmt->group.stmts.length; i++) {
+                if (always_returns(
+                        self,
+                        EpsAst_ListGet(self->ast, stmt->group.stmts, i)))
+                    return true;
+            }
+        } break;
+        case S_IF:
+            return stmt->conditional._else != EPS_AST_NONE
+                && always_returns(self, stmt->conditional.body)
+                && always_returns(self, stmt->conditional._else);
+        default: break;
+    }
+
+    return false;
+}
+
+// Type of the value function call evaluates to,
+// function may fall off its end returning void
+static Eps_ObjectType
+call_type(Checker *self, const Eps_StatementFunc *func)
+{
+    if (func->type == OBJ_VOID || always_returns(self, func->body))
+        return func->type;
+
+    return OBJ_ANY;
+}
+
+// * - Expressions -
+
+static Eps_ObjectType
+check_call(Checker *self, Eps_Call *call)
+{
+    Eps_AstIndex decl = lookup(self, call->depth, call->slot)->func;
+    const Eps_StatementFunc *func = NULL;
+    uint32_t argc = call->args.length;
+    uint32_t i;
+    bool checked;
+
+    // functions defined later are not known in stream mode
+    if (decl != EPS_AST_NONE)
+        func = &EpsAst_Stmt(self->ast, decl)->func;
+
+    checked = func != NULL;
+
+    if (func != NULL && argc < func->params.length) {
+        type_error(
+            call->identifier.span,
+            "too few arguments in function '%s' call",
+            call->identifier.name->str
+        );
+    }
+
+    if (func != NULL && argc > func->params.length) {
+        type_error(
+            call->identifier.span,
+            "too much argiments in '%s' function call",
+            call->identifier.name->str
+        );
+    }
+
+    for (i = 0; i < argc; i++) {
+        Eps_AstIndex arg = EpsAst_ListGet(self->ast, call->args, i);
+        Eps_ObjectType type = check_expr(self, arg);
+        Eps_Param *param;
+
+        if (func == NULL || i >= func->params.length)
+            continue;
+
+        param = EpsAst_Param(self->ast, func->params, i);
+
+        if (type == OBJ_ANY) {
+            checked = false;
+        } else if (param->type != OBJ_ANY && type != param->type) {
+            type_error(
+                EpsAst_Expr(self->ast, arg)->span,
+                "cannot pass '%s' as parameter '%s' type '%s'",
+                type_string(type),
+                param->identifier.name->str,
+                type_string(param->type)
+            );
+        }
+    }
+
+    // calls are linked to the functions known statically
+    call->func = decl;
+    call->checked = checked;
+
+    return func != NULL ? call_type(self, func) : OBJ_ANY;
+}
+
+static Eps_ObjectType
+check_primary(Checker *self, Eps_Expression *node)
+{
+    switch (node->primary) {
+        case PRIMARY_LIT:
+            return node->literal.type;
+        case PRIMARY_PAREN:
+            return check_expr(self, node->expr);
+        case PRIMARY_CALL:
+            return check_call(self, EpsAst_Call(self->ast, node->call));
+        case PRIMARY_ID:
+            return lookup(self, node->var.depth, node->var.slot)->type;
+    }
+
+    return OBJ_ANY;
+}
+
+static Eps_ObjectType
+check_binary(Checker *self, Eps_Expression *node)
+{
+    Eps_ObjectType left = check_expr(self, node->binary.left);
+    Eps_ObjectType right = check_expr(self, node->binary.right);
+
+    if (left == OBJ_ANY || right == OBJ_ANY)
+        return OBJ_ANY;
+
+    if (left == OBJ_REAL && right == OBJ_REAL) {
+        switch (node->operator) {
+            case PLUS: case MINUS:
+            case STAR: case SLASH:
+                return OBJ_REAL;
+            default:
+                return OBJ_BOOL;
+        }
+    }
+
+    if (left == OBJ_STRING && right == OBJ_STRING) {
+        if (node->operator == PLUS)
+            return OBJ_STRING;
+
+        if (node->operator == EQUAL || node->operator == BANG_EQUAL)
+            return OBJ_BOOL;
+
+        type_error(
+            node->binary.op_span,
+            "cannot apply '%s' to arguments type 'string'",
+            Eps_GetTokenLexeme(node->operator)
+        );
+    } else {
+        type_error(
+            node->binary.op_span,
+            "cannot apply binary operator to operands type '%s' and '%s'",
+            type_string(left),
+            type_string(right)
+        );
+    }
+
+    return OBJ_ANY;
+}
+
+static Eps_ObjectType
+check_unary(Checker *self, Eps_Expression *node)
+{
+    Eps_ObjectType right = check_expr(self, node->unary.right);
+
+    switch (node->operator) {
+        case MINUS:
+            if (right == OBJ_ANY || right == OBJ_REAL)
+                return right;
+        break;
+        case STR:
+            if (right != OBJ_VOID)
+                return right == OBJ_ANY ? OBJ_ANY : OBJ_STRING;
+        break;
+        default:
+        {
+            type_error(
+                node->unary.op_span,
+                "unknown operator '%s'",
+                Eps_GetTokenLexeme(node->operator)
+            );
+        } return OBJ_ANY;
+    }
+
+    type_error(
+        node->unary.op_span,
+        "cannot apply %s to expression type %s",
+        Eps_GetTokenLexeme(node->operator),
+        type_string(right)
+    );
+
+    return OBJ_ANY;
+}
+
+// Conditions have to be boolean
+static void
+check_cond(Checker *self, Eps_AstIndex cond)
+{
+    Eps_ObjectType type = check_expr(self, cond);
+
+    if (type != OBJ_ANY && type != OBJ_BOOL) {
+        type_error(
+            EpsAst_Expr(self->ast, cond)->span,
+            "invalid condition type '%s'",
+            type_string(type)
+        );
+    }
+}
+
+static Eps_ObjectType
+check_ternary(Checker *self, Eps_Expression *node)
+{
+    Eps_ObjectType left, right;
+
+    check_cond(self, node->ternary.cond);
+    left = check_expr(self, node->ternary.left);
+    right = check_expr(self, node->ternary.right);
+
+    return left == right ? left : OBJ_ANY;
+}
+
+static Eps_ObjectType
+check_expr(Checker *self, Eps_AstIndex index)
+{
+    Eps_Expression *expr = EpsAst_Expr(self->ast, index);
+    Eps_ObjectType type = OBJ_ANY;
+
+    switch (expr->type) {
+        case NODE_TERNARY:
+            type = check_ternary(self, expr);
+        break;
+        case NODE_BIN:
+            type = check_binary(self, expr);
+        break;
+        case NODE_UNARY:
+            type = check_unary(self, expr);
+        break;
+        case NODE_PRIMARY:
+            type = check_primary(self, expr);
+        break;
+    }
+
+    expr->value_type = type;
+
+    return type;
+}
+
+// * - Statements -
+
+static void
+check_stmts(Checker *self, Eps_AstList stmts)
+{
+    uint32_t i;
+
+    for (i = 0; i < stmts.length; i++) {
+        check_stmt(self, EpsAst_ListGet(self->ast, stmts, i));
+    }
+}
+
+static void
+check_group(Checker *self, Eps_StatementGroup *group)
+{
+    Scope scope;
+
+    // blocks sharing the enclosing frame use its slots
+    if (!group->frame) {
+        check_stmts(self, group->stmts);
+        return;
+    }
+
+    begin_scope(self, &scope, group->scope_size);
+    check_stmts(self, group->stmts);
+    end_scope(self);
+}
+
+static void
+check_func(Checker *self, Eps_AstIndex index)
+{
+    Eps_StatementFunc *func = &EpsAst_Stmt(self->ast, index)->func;
+    const Eps_StatementFunc *enclosing = self->func;
+    Scope scope;
+    uint32_t i;
+
+    declare(self, func->slot, OBJ_FUNC, index);
+
+    // parameters take the first slots of the function frame
+    begin_scope(self, &scope, func->scope_size);
+
+    for (i = 0; i < func->params.length; i++) {
+        scope.slots[i].type = EpsAst_Param(self->ast, func->params, i)->type;
+    }
+
+    self->func = func;
+    check_stmt(self, func->body);
+    self->func = enclosing;
+
+    end_scope(self);
+}
+
+static void
+check_return(Checker *self, Eps_StatementReturn *stmt)
+{
+    Eps_ObjectType type;
+
+    if (stmt->expr == EPS_AST_NONE)
+        return;
+
+    type = check_expr(self, stmt->expr);
+
+    // returning outside of the function is reported at runtime
+    if (self->func == NULL || type == OBJ_ANY || type == self->func->type)
+        return;
+
+    type_error(
+        EpsAst_Expr(self->ast, stmt->expr)->span,
+        "cannot return '%s' from a function type '%s'",
+        type_string(type),
+        type_string(self->func->type)
+    );
+}
+
+static void
+check_define(Checker *self, Eps_StatementVar *stmt, bool constant)
+{
+    Eps_ObjectType type = check_expr(self, stmt->expr);
+
+    if (type != OBJ_ANY && type != stmt->type) {
+        type_error(
+            stmt->identifier.span,
+            "cannot assign value type '%s' to %s type '%s'",
+            type_string(type),
+            constant ? "const" : "variable",
+            type_string(stmt->type)
+        );
+    }
+
+    declare(self, stmt->slot, stmt->type, EPS_AST_NONE);
+}
+
+static void
+check_assign(Checker *self, Eps_StatementVar *stmt)
+{
+    Eps_ObjectType type = check_expr(self, stmt->expr);
+
+    stmt->type = lookup(self, stmt->depth, stmt->slot)->type;
+
+    if (type != OBJ_ANY && stmt->type != OBJ_ANY && type != stmt->type) {
+        type_error(
+            stmt->identifier.span,
+            "cannot assign '%s' to variable type '%s'",
+            type_string(type),
+            type_string(stmt->type)
+        );
+    }
+}
+
+static void
+check_stmt(Checker *self, Eps_AstIndex index)
+{
+    Eps_Statement *stmt = EpsAst_Stmt(self->ast, index);
+
+    switch (stmt->type) {
+        case S_EXPR:
+            check_expr(self, stmt->expr.expr);
+        break;
+        case S_GROUP:
+            check_group(self, &stmt->group);
+        break;
+        case S_OUTPUT:
+        {
+            if (check_expr(self, stmt->output.expr) == OBJ_VOID) {
+                type_error(
+                    EpsAst_Expr(self->ast, stmt->output.expr)->span,
+                    "cannot output value type of 'void'"
+                );
+            }
+        } break;
+        case S_IF:
+            check_cond(self, stmt->conditional.cond);
+            check_stmt(self, stmt->conditional.body);
+
+            if (stmt->conditional._else != EPS_AST_NONE)
+                check_stmt(self, stmt->conditional._else);
+        break;
+        case S_FUNC:
+            check_func(self, index);
+        break;
+        case S_RETURN:
+            check_return(self, &stmt->ret);
+        break;
+        case S_CONST:
+            check_define(self, &stmt->define, true);
+        break;
+        case S_DEFINE:
+            check_define(self, &stmt->define, false);
+        break;
+        case S_ASSIGN:
+            check_assign(self, &stmt->assign);
+        break;
+    }
+}
+
+void
+Eps_TypeCheck(Eps_Ast *ast)
+{
+    _DEBUG("--------------- TYPE CHECKER ---------------\n");
+
+    Eps_TypeChecker *checker = EpsTypeChecker_Create(ast);
+    uint32_t i;
+
+    hoist_globals(checker, ast->program);
+
+    for (i = 0; i < ast->program.length; i++) {
+        check_stmt(checker, EpsAst_ListGet(ast, ast->program, i));
+    }
+
+    EpsTypeChecker_Destroy(checker);
+}
+
+Eps_TypeChecker *
+EpsTypeChecker_Create(Eps_Ast *ast)
+{
+    Eps_TypeChecker *self = EpsMem_Alloc(sizeof(Eps_TypeChecker));
+
+    self->ast = ast;
+    self->current = NULL;
+    self->globals = NULL;
+    self->globals_length = 0;
+    self->func = NULL;
+
+    return self;
+}
+
+void
+EpsTypeChecker_Destroy(Eps_TypeChecker *self)
+{
+    EpsMem_Free(self->globals);
+    EpsMem_Free(self);
+}
+
+void
+EpsTypeChecker_Next(Eps_TypeChecker *self, Eps_AstIndex stmt)
+{
+    check_stmt(self, stmt);
+}
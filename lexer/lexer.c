@@ -2,7 +2,6 @@
 #include "lexer/token.h"
 #include "core/input.h"
 #include "core/memory.h"
-#include "core/ds/list.h"
 #include "core/errors.h"
 #include "core/debug_macros.h"
 #include <string.h>
@@ -12,26 +11,67 @@
 #include <stdbool.h>
 #include <stdarg.h>
 
+#if defined(__SSE2__) && !defined(EPS_NO_SIMD)
+#   include <emmintrin.h>
+#   define LEXER_SSE2
+#endif
 
 #define lexeme_cmp(a, b) (strcmp((a), (b)) == 0)
 
 // * - Utils -
 
+// Record that a new line starts at 'offset'
+static void
+add_line(Eps_Input *input, size_t offset)
+{
+    // table doubles when full, starting from 64 lines
+    if (input->line_count == input->line_capacity) {
+        input->line_capacity = input->line_capacity
+            ? input->line_capacity*2
+            : 64;
+        input->lines = EpsMem_Realloc(
+            input->lines,
+            sizeof(size_t)*input->line_capacity
+        );
+    }
+
+    input->lines[input->line_count++] = offset;
+}
+
+// Record newlines of the block at 'base' set in 'mask'
+static void
+add_lines(Eps_Input *input, size_t base, unsigned mask)
+{
+    while (mask) {
+        add_line(input, base + __builtin_ctz(mask) + 1);
+        mask &= mask - 1;
+    }
+}
+
+// Make sure byte at 'pos' is read in,
+// false if the input ends before it
+static bool
+available(Eps_LexState *ls, size_t pos)
+{
+    while (pos >= ls->input->len) {
+        if (!Eps_ReadMore(ls->input))
+            return false;
+    }
+
+    return true;
+}
+
 // Return and consume raw character
 static int
 get_char(Eps_LexState *ls)
 {
-    if (ls->current >= ls->input->len)
+    if (!available(ls, ls->current))
         return EOF;
 
-    int c = ls->input->raw[ls->current++];
-
-    if (c == '\n') {
-        ls->line++;
-        ls->col = 0;
-    }
+    int c = ls->input->raw[ls->current++ - ls->input->base];
 
-    ls->col++;
+    if (c == '\n')
+        add_line(ls->input, ls->current);
 
     return c;
 }
@@ -40,21 +80,166 @@ get_char(Eps_LexState *ls)
 static int
 char_at(Eps_LexState *ls, size_t pos)
 {
-    if (pos >= ls->input->len)
+    if (!available(ls, pos))
         return EOF;
 
-    return ls->input->raw[pos];
+    return ls->input->raw[pos - ls->input->base];
 }
 
+// * - Bulk Scanning -
+
+// Whitespace runs, comments and string bodies are scanned
+// 16 bytes at a time, the tail of the input byte by byte
+
+#ifdef LEXER_SSE2
+// Mask of bytes isspace() accepts: ' ' and '\t'..'\r'
+static unsigned
+space_mask(__m128i block)
+{
+    __m128i ctrl = _mm_sub_epi8(block, _mm_set1_epi8('\t'));
+    __m128i is_ctrl = _mm_cmpeq_epi8(
+        _mm_min_epu8(ctrl, _mm_set1_epi8('\r' - '\t')),
+        ctrl
+    );
+    __m128i is_space = _mm_cmpeq_epi8(block, _mm_set1_epi8(' '));
+
+    return _mm_movemask_epi8(_mm_or_si128(is_ctrl, is_space));
+}
+
+static unsigned
+byte_mask(__m128i block, char c)
+{
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8(c)));
+}
+#endif
+
+// Scan read-in input from 'pos' past whitespace, returns
+// position of the first other char or the end of what is read
+static size_t
+scan_spaces(Eps_Input *input, size_t pos)
+{
+    // scanning goes on relative to the start of raw
+    const char *raw = input->raw;
+    size_t base = input->base;
+    size_t len = input->len - base;
+
+    pos -= base;
+
+    // tokens are mostly separated by a single space or nothing
+    if (pos < len && !isspace((unsigned char)raw[pos]))
+        return base + pos;
+
+#ifdef LEXER_SSE2
+    while (pos + 16 <= len) {
+        __m128i block = _mm_loadu_si128((const __m128i *)&raw[pos]);
+        unsigned spaces = space_mask(block);
+        unsigned newlines = byte_mask(block, '\n');
+
+        if (spaces != 0xffff) {
+            unsigned stop = __builtin_ctz(~spaces);
+
+            add_lines(input, base + pos, newlines & ((1u << stop) - 1));
+            return base + pos + stop;
+        }
+
+        add_lines(input, base + pos, newlines);
+        pos += 16;
+    }
+#endif
+
+    while (pos < len && isspace((unsigned char)raw[pos])) {
+        if (raw[pos] == '\n')
+            add_line(input, base + pos + 1);
+        pos++;
+    }
+
+    return base + pos;
+}
+
+// The same for the next 'stop' char
+static size_t
+scan_until(Eps_Input *input, size_t pos, char stop)
+{
+    // scanning goes on relative to the start of raw
+    const char *raw = input->raw;
+    size_t base = input->base;
+    size_t len = input->len - base;
+
+    pos -= base;
+
+#ifdef LEXER_SSE2
+    while (pos + 16 <= len) {
+        __m128i block = _mm_loadu_si128((const __m128i *)&raw[pos]);
+        unsigned found = byte_mask(block, stop);
+        unsigned newlines = byte_mask(block, '\n');
+
+        if (found) {
+            unsigned at = __builtin_ctz(found);
+
+            add_lines(input, base + pos, newlines & ((1u << at) - 1));
+            return base + pos + at;
+        }
+
+        add_lines(input, base + pos, newlines);
+        pos += 16;
+    }
+#endif
+
+    while (pos < len && raw[pos] != stop) {
+        if (raw[pos] == '\n')
+            add_line(input, base + pos + 1);
+        pos++;
+    }
+
+    return base + pos;
+}
+
+// Read the next chunk of a stream after the run skipped up to 'pos',
+// which is dropped if the parser needs nothing before the next token
+static bool
+read_past(Eps_LexState *ls, size_t pos)
+{
+    if (ls->discard)
+        Eps_DiscardInput(ls->input, pos);
+
+    return Eps_ReadMore(ls->input);
+}
+
+// Skip whitespace, stops at the first other char
+static void
+skip_spaces(Eps_LexState *ls)
+{
+    size_t pos = scan_spaces(ls->input, ls->current);
+
+    // run may go on in the next chunk of a stream
+    while (pos == ls->input->len && read_past(ls, pos))
+        pos = scan_spaces(ls->input, pos);
+
+    ls->current = pos;
+}
+
+// Skip to the next 'stop' char or to the end of input
+static void
+skip_until(Eps_LexState *ls, char stop)
+{
+    size_t pos = scan_until(ls->input, ls->current, stop);
+
+    while (pos == ls->input->len && read_past(ls, pos))
+        pos = scan_until(ls->input, pos, stop);
+
+    ls->current = pos;
+}
+
+// * - Lexer Navigation -
+
 // Return and consume the character
 static int
 advance(Eps_LexState *ls)
 {
     int c;
 
-    while (isspace(c = get_char(ls)) && c != EOF)
-        ;
-
+    skip_spaces(ls);
+    c = get_char(ls);
     ls->end = ls->current;
 
     return c;
@@ -67,13 +252,6 @@ current(Eps_LexState *ls)
     return char_at(ls, ls->current);
 }
 
-// Return prev char
-static int
-prev(Eps_LexState *ls)
-{
-    return char_at(ls, ls->current-1);
-}
-
 // Check if current char matches expected 'c',
 // if so, consume the character
 static bool
@@ -87,47 +265,21 @@ match(Eps_LexState *ls, char c)
     return false;
 }
 
-// Check if next char sequence matches 'word',
-// if so, consume that sequence
-static bool
-match_word(Eps_LexState *ls, const char word[]) {
-    size_t i = 0;
-    size_t len = strlen(word);
-
-    while (i < len) {
-        if (char_at(ls, ls->current + i) == word[i]) {
-            i++;
-        } else {
-            return false;
-        }
-    }
-
-    ls->current += i;
-    return true;
-}
-
-// Return substring from a current file
-static char *
-get_substr(Eps_LexState *ls, size_t start, size_t end)
+// Create token from LexState and TokenType,
+// the token refers to the lexeme in the input
+static Eps_Token
+create_token(Eps_LexState *ls, Eps_TokenType toktype)
 {
-    size_t strsz = sizeof(char)*end-start+1;
-    char *substr = EpsMem_Alloc(strsz);
+    // lengths are 32-bit, unlike the offsets
+    if (ls->end - ls->start > UINT32_MAX)
+        EpsErr_Fatal("token is longer than 4 GiB");
 
-    memcpy(substr, &ls->input->raw[start], strsz-1);
-    substr[strsz] = '\0';
-
-    return substr;
-}
+    Eps_Token t = {
+        .offset = ls->start, .length = ls->end - ls->start,
+        .toktype = toktype
+    };
 
-// Create token from LexState and TokenType
-static Eps_Token *
-create_token(Eps_LexState *ls, Eps_TokenType toktype)
-{
-    return Eps_CreateToken(
-        ls,
-        toktype,
-        get_substr(ls, ls->start, ls->end)
-    );
+    return t;
 }
 
 // * - Lexical Errors -
@@ -136,7 +288,9 @@ static void
 lexerror(Eps_LexState *ls, char format[], ...)
 {
     ERR_INSTANCE_INIT_BUFFER();
-    EpsErr_Raise(ls, "Lexical error", buffer);
+
+    Eps_SrcSpan span = { .offset = ls->start, .length = ls->end - ls->start };
+    EpsErr_Raise(span, "Lexical error", buffer);
 }
 
 // * - Lexer Utils -
@@ -144,14 +298,12 @@ lexerror(Eps_LexState *ls, char format[], ...)
 static void
 line_comment(Eps_LexState *ls)
 {
-    int c = get_char(ls);
-
-    while (c != '\n' && c != EOF)
-        c = get_char(ls);
+    skip_until(ls, '\n');
+    get_char(ls); // newline
 }
 
 // Parse number
-static Eps_Token *
+static Eps_Token
 number(Eps_LexState *ls)
 {
     int c = current(ls);
@@ -169,18 +321,17 @@ number(Eps_LexState *ls)
 }
 
 // Parse string token
-static Eps_Token *
+static Eps_Token
 string(Eps_LexState *ls)
 {
-    int c = advance(ls);
+    int c;
 
-    while (c != '"' && c != '\n') {
-        if (c == EOF) {
-            lexerror(ls, "unterminated string");
-            break;
-        }
+    skip_until(ls, '"');
+    c = get_char(ls);
+    ls->end = ls->current;
 
-        c = advance(ls);
+    if (c == EOF) {
+        lexerror(ls, "unterminated string");
     }
 
     return create_token(ls, STRING);
@@ -190,131 +341,88 @@ static Eps_TokenType
 identifier(Eps_LexState *ls)
 {
     while (isalnum(current(ls)))
-        advance(ls);
+        ls->current++;
+
+    ls->end = ls->current;
 
     return IDENTIFIER;
 }
 
+// * - Keywords -
+
+// Keywords are looked up by a perfect hash of the first two
+// characters and the length. The multiplier is found by brute
+// force, check the table has no collisions when adding a keyword.
+#define KEYWORD_HASH(c0, c1, len) (((c0) + 14*(c1) + (len)) & 31)
+
+typedef struct {
+    const char    *word;
+    size_t         length;
+    Eps_TokenType  toktype;
+} Keyword;
+
+static const Keyword keywords[32] = {
+    [3]  = { "not",    3, NOT    },
+    [8]  = { "and",    3, AND    },
+    [12] = { "void",   4, VOID   },
+    [13] = { "or",     2, OR     },
+    [14] = { "str",    3, STR    },
+    [16] = { "func",   4, FUNC   },
+    [17] = { "else",   4, ELSE   },
+    [20] = { "true",   4, TRUE   },
+    [21] = { "let",    3, LET    },
+    [24] = { "bool",   4, BOOL   },
+    [25] = { "false",  5, FALSE  },
+    [26] = { "const",  5, CONST  },
+    [27] = { "output", 6, OUTPUT },
+    [28] = { "real",   4, REAL   },
+    [30] = { "return", 6, RETURN },
+    [31] = { "if",     2, IF     },
+};
+
+// Scans the whole word and classifies it with a single lookup
 static Eps_TokenType
 keyword(Eps_LexState *ls)
 {
-    size_t start = ls->end-1;
-
-    /* Checking if that's an keyword */
-    switch (prev(ls)) {
-        case 'a': {
-            if (match_word(ls, "nd")) {
-                return AND;
-            }
-
-            return identifier(ls);
-        }
-        case 'c': {
-            if (match_word(ls, "onst")) {
-                return CONST;
-            }
-
-            return identifier(ls);
-        }
-        case 'f': {
-            if (match_word(ls, "unc")) {
-                return FUNC;
-            }
-            else if (match_word(ls, "alse")) {
-                return FALSE;
-            }
-
-            return identifier(ls);
-        }
-        case 'e': {
-            if (match_word(ls, "lse")) {
-                return ELSE;
-            }
-
-            return identifier(ls);
-        }
-        case 'i': {
-            if (match_word(ls, "f")) {
-                return IF;
-            }
-
-            return identifier(ls);
-        }
-        case 'l': {
-            if (match_word(ls, "et")) {
-                return LET;
-            }
+    const char *word;
+    size_t len;
+    const Keyword *kw;
 
-            return identifier(ls);
-        }
-        case 'v': {
-            if (match_word(ls, "oid")) {
-                return VOID;
-            }
+    identifier(ls);
 
-            return identifier(ls);
-        }
-        case 'o': {
-            if (match_word(ls, "r")) {
-                return OR;
-            } else if (match_word(ls, "utput")) {
-                return OUTPUT;
-            }
+    word = &ls->input->raw[ls->start - ls->input->base];
+    len = ls->end - ls->start;
+    kw = &keywords[KEYWORD_HASH(
+        (unsigned char)word[0],
+        len > 1 ? (unsigned char)word[1] : 0,
+        len
+    )];
 
-            return identifier(ls);
-        }
-        case 'n': {
-            if (match_word(ls, "ot")) {
-                return NOT;
-            }
-
-            return identifier(ls);
-        }
-        case 'r': {
-            if (match_word(ls, "eturn")) {
-                return RETURN;
-            }
-            else if (match_word(ls, "eal")) {
-                return REAL;
-            }
-            _DEBUG("DEBUG: %c\n", current(ls));
+    if (kw->length == len && memcmp(kw->word, word, len) == 0)
+        return kw->toktype;
 
-            return identifier(ls);
-        }
-        case 's': {
-            if (match_word(ls, "tr")) {
-                return STR;
-            }
-            return identifier(ls);
-        }
-        case 'b': {
-            if (match_word(ls, "ool")) {
-                return BOOL;
-            }
-
-            return identifier(ls);
-        }
-        case 't': {
-            if (match_word(ls, "rue")) {
-                return TRUE;
-            }
-
-            return identifier(ls);
-        }
-        default: {
-            return identifier(ls);
-        }
-    }
+    return IDENTIFIER;
 }
 
-static Eps_Token *
+static Eps_Token
 get_token(Eps_LexState *ls)
 {
-    Eps_Token *t;
+    Eps_Token t;
     int c;
 
-    c = advance(ls);
-    ls->start = ls->end-1;
+    // comments make no tokens, scanning goes on past them
+    for (;;) {
+        c = advance(ls);
+        ls->start = ls->end-1;
+
+        if (c != '-' || !match(ls, '-'))
+            break;
+
+        line_comment(ls);
+    }
+
+    // text of the token is needed from here on
+    ls->discard = false;
 
     switch (c) {
         case '(':
@@ -339,9 +447,6 @@ get_token(Eps_LexState *ls)
         {
             if (match(ls, '>')) { // ->
                 t = create_token(ls, ARROW_RIGHT);
-            } else if (match(ls, '-')) { // --
-                line_comment(ls);
-                t = get_token(ls);
             } else {
 			    t = create_token(ls, MINUS);
             }
@@ -411,7 +516,7 @@ get_token(Eps_LexState *ls)
                 t = create_token(ls, keyword(ls));
             } else { // otherwise, we don't know what it is
                 t = create_token(ls, ERRORTOKEN);
-                lexerror(&t->ls, "illegal token '%s'", t->lexeme);
+                lexerror(ls, "illegal token '%c'", c);
             }
         } break;
     }
@@ -419,32 +524,55 @@ get_token(Eps_LexState *ls)
     return t;
 }
 
-EpsList *
+void
+Eps_LexInit(Eps_LexState *ls, Eps_Input *input)
+{
+    ls->fname = input->name;
+    ls->input = input;
+    ls->start = 0;
+    ls->end = 0;
+    ls->current = 0;
+    ls->discard = false;
+
+    // line index is rebuilt while scanning, first line starts at 0
+    EpsMem_Free(input->lines);
+    input->lines = NULL;
+    input->line_count = 0;
+    input->line_capacity = 0;
+    add_line(input, 0);
+
+    // errors are reported against this input from now on
+    EpsErr_SetSource(input);
+}
+
+Eps_Token
+Eps_LexToken(Eps_LexState *ls)
+{
+    Eps_Token tok = get_token(ls);
+
+#ifdef EPS_DBG
+    _EpsDbg_TokenDump(&tok);
+#endif
+
+    return tok;
+}
+
+Eps_TokenBuf *
 Eps_Lex(Eps_Input *input)
 {
     Eps_LexState ls;
-    Eps_Token *t;
-    EpsList *tokens;
-
-    ls.fname = input->name;
-    ls.input = input;
-    ls.line = 1;
-    ls.col = 0;
-    ls.start = 0;
-    ls.end = 0;
-    ls.current = 0;
+    Eps_Token tok;
+    Eps_TokenBuf *tokens;
 
-    tokens = EpsList_Create();
+    Eps_LexInit(&ls, input);
+    tokens = EpsTokenBuf_Create();
 
     _DEBUG("----------------- LEXER -----------------\n");
 
     do {
-        t = get_token(&ls);
-        EpsList_Append(tokens, t);
-#ifdef EPS_DBG
-        _EpsDbg_TokenDump(t);
-#endif
-    } while (t->toktype != T_EOF);
+        tok = Eps_LexToken(&ls);
+        EpsTokenBuf_Push(tokens, tok);
+    } while (tok.toktype != T_EOF);
 
     return tokens;
 }
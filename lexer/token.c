@@ -3,23 +3,92 @@
 #include <string.h>
 #include <stdio.h>
 
-Eps_Token *
-Eps_CreateToken(Eps_LexState *ls, Eps_TokenType toktype, char lexeme[])
+#define TOKEN_BUF_INIT_CAPACITY 256
+
+// Warning: do not change the order
+static const char *token_lexemes[] = {
+	"(",
+	")",
+	"{",
+	"}",
+	",",
+	".",
+	"-",
+	"+",
+	"output",
+	":",
+	";",
+	"/",
+	"*",
+	"!",
+	"!=",
+	"=",
+	">",
+	">=",
+	"<",
+	"<=",
+	NULL, // IDENTIFIER
+	NULL, // STRING
+	NULL, // NUMBER
+	"and",
+	"const",
+	"func",
+	"else",
+	"false",
+	"if",
+	"let",
+	"str",
+	"void",
+	"or",
+	"not",
+	"return",
+	"real",
+	"bool",
+	"true",
+	"->",
+	"<-",
+	NULL, // T_EOF
+	NULL, // COMMENT
+	NULL, // ERRORTOKEN
+};
+
+const char *
+Eps_GetTokenLexeme(Eps_TokenType toktype)
+{
+    return token_lexemes[toktype];
+}
+
+Eps_TokenBuf *
+EpsTokenBuf_Create(void)
 {
-    Eps_Token* t = EpsMem_Alloc(sizeof(Eps_Token));
+    Eps_TokenBuf *buf = EpsMem_Alloc(sizeof(Eps_TokenBuf));
 
-    memcpy(&t->ls, ls, sizeof(Eps_LexState));
-    t->toktype = toktype;
-    t->lexeme = lexeme;
+    buf->items = EpsMem_Alloc(sizeof(Eps_Token)*TOKEN_BUF_INIT_CAPACITY);
+    buf->length = 0;
+    buf->capacity = TOKEN_BUF_INIT_CAPACITY;
 
-    return t;
+    return buf;
 }
 
 void
-Eps_DestroyToken(Eps_Token *tok)
+EpsTokenBuf_Destroy(Eps_TokenBuf *buf)
 {
-    EpsMem_Free(tok->lexeme);
-    EpsMem_Free(tok);
+    EpsMem_Free(buf->items);
+    EpsMem_Free(buf);
+}
+
+void
+EpsTokenBuf_Push(Eps_TokenBuf *buf, Eps_Token tok)
+{
+    if (buf->length == buf->capacity) {
+        buf->capacity *= 2;
+        buf->items = EpsMem_Realloc(
+            buf->items,
+            sizeof(Eps_Token)*buf->capacity
+        );
+    }
+
+    buf->items[buf->length++] = tok;
 }
 
 char *
@@ -0,0 +1,562 @@
+#include "optimizer.h"
+#include "parser.h"
+#include "ast.h"
+#include "core/ds/dict.h"
+#include "core/memory.h"
+#include "core/debug_macros.h"
+#include <math.h>
+#include <string.h>
+
+// Folding mirrors runtime semantics, expressions which raise an
+// error at runtime are left as they are so the error is reported
+
+// Local name, shadows top-level constants
+typedef struct {
+    Eps_Symbol     *name;
+    Eps_ObjectType  type; // OBJ_REAL if value is known to be real,
+                          // OBJ_UNDEFINED otherwise
+} Local;
+
+// Top-level variable or constant
+typedef struct {
+    Eps_ObjectType type;   // declared type
+    Eps_Object     value;  // constant value, OBJ_UNDEFINED if unknown
+    bool           shared; // defined before any top-level call, so
+                           // functions can't run before the definition
+} Global;
+
+typedef struct Eps_Optimizer {
+    Eps_Ast *ast;
+    Local   *locals;
+    size_t   length;
+    size_t   capacity;
+    size_t   func_base;   // first local of the innermost function
+    size_t   functions;   // number of enclosing function bodies
+    size_t   scopes;      // number of enclosing blocks and functions
+    size_t   conditional; // number of enclosing conditional bodies
+    bool     called;      // whether top-level code has made a call
+    EpsDict *globals;     // name -> Global
+} Optimizer;
+
+static void
+optimize_stmt(Optimizer *self, Eps_AstIndex stmt);
+
+static void
+optimize_expr(Optimizer *self, Eps_AstIndex expr);
+
+// * - Names -
+
+static void
+declare_local(Optimizer *self, Eps_Symbol *name, Eps_ObjectType type)
+{
+    if (self->length == self->capacity) {
+        self->capacity = self->capacity ? self->capacity*2 : 16;
+        self->locals = EpsMem_Realloc(
+            self->locals,
+            sizeof(Local)*self->capacity
+        );
+    }
+
+    // variables defined conditionally may be not defined at all
+    self->locals[self->length].name = name;
+    self->locals[self->length].type = self->conditional ? OBJ_UNDEFINED : type;
+    self->length++;
+}
+
+static Local *
+find_local(Optimizer *self, Eps_Symbol *name)
+{
+    size_t i;
+
+    for (i = self->length; i > 0; i--) {
+        if (self->locals[i-1].name == name)
+            return &self->locals[i-1];
+    }
+
+    return NULL;
+}
+
+// Returns global 'name' refers to, NULL if it is unknown
+static Global *
+find_global(Optimizer *self, Eps_Symbol *name)
+{
+    Global *global;
+
+    if (find_local(self, name) != NULL)
+        return NULL;
+
+    global = EpsDict_Get(self->globals, name);
+
+    if (global == NULL || (self->functions > 0 && !global->shared))
+        return NULL;
+
+    return global;
+}
+
+static void
+destroy_global(void *global)
+{
+    EpsObject_Destroy(&((Global *)global)->value);
+    EpsMem_Free(global);
+}
+
+static void
+define(Optimizer *self, Eps_StatementVar *stmt, bool constant)
+{
+    Eps_Expression *init = EpsAst_Expr(self->ast, stmt->expr);
+    Global *global, *prev;
+
+    if (self->scopes > 0) {
+        declare_local(self, stmt->identifier.name, stmt->type);
+        return;
+    }
+
+    if (self->conditional > 0)
+        return;
+
+    global = EpsMem_Alloc(sizeof(Global));
+    global->type = stmt->type;
+    global->value.type = OBJ_UNDEFINED;
+    global->shared = !self->called;
+
+    if (constant && init->type == NODE_PRIMARY && init->primary == PRIMARY_LIT
+                 && init->literal.type == stmt->type)
+        global->value = EpsObject_Clone(init->literal);
+
+    prev = EpsDict_Delete(self->globals, stmt->identifier.name);
+
+    if (prev != NULL)
+        destroy_global(prev);
+
+    EpsDict_Set(self->globals, stmt->identifier.name, global);
+}
+
+// * - Expressions -
+
+static bool
+is_literal(Eps_Expression *node)
+{
+    return node->type == NODE_PRIMARY && node->primary == PRIMARY_LIT;
+}
+
+static bool
+is_real_literal(Eps_Expression *node, double val)
+{
+    return is_literal(node)
+        && node->literal.type == OBJ_REAL
+        && node->literal.real == val
+        && !signbit(node->literal.real);
+}
+
+// Whether expression is known to evaluate to a real
+static bool
+is_real(Optimizer *self, Eps_AstIndex index)
+{
+    Eps_Expression *node = EpsAst_Expr(self->ast, index);
+
+    switch (node->type) {
+        case NODE_BIN:
+            return (node->operator == PLUS || node->operator == MINUS
+                 || node->operator == STAR || node->operator == SLASH)
+                && is_real(self, node->binary.left)
+                && is_real(self, node->binary.right);
+        case NODE_UNARY:
+            return node->operator == MINUS && is_real(self, node->unary.right);
+        case NODE_PRIMARY:
+        {
+            switch (node->primary) {
+                case PRIMARY_LIT:
+                    return node->literal.type == OBJ_REAL;
+                case PRIMARY_PAREN:
+                    return is_real(self, node->expr);
+                case PRIMARY_ID:
+                {
+                    // locals of enclosing functions are not tracked
+                    Local *local = find_local(self, node->var.name);
+                    Global *global;
+
+                    if (local != NULL)
+                        return local >= &self->locals[self->func_base]
+                            && local->type == OBJ_REAL;
+
+                    global = find_global(self, node->var.name);
+
+                    return global != NULL && global->type == OBJ_REAL;
+                }
+                default: break;
+            }
+        } break;
+        default: break;
+    }
+
+    return false;
+}
+
+// Whether expression refers to no names, so dropping it
+// doesn't hide errors reported before the program runs
+static bool
+is_closed(Optimizer *self, Eps_AstIndex index)
+{
+    Eps_Expression *node = EpsAst_Expr(self->ast, index);
+
+    switch (node->type) {
+        case NODE_TERNARY:
+            return is_closed(self, node->ternary.cond)
+                && is_closed(self, node->ternary.left)
+                && is_closed(self, node->ternary.right);
+        case NODE_BIN:
+            return is_closed(self, node->binary.left)
+                && is_closed(self, node->binary.right);
+        case NODE_UNARY:
+            return is_closed(self, node->unary.right);
+        case NODE_PRIMARY:
+            return node->primary == PRIMARY_LIT
+                || (node->primary == PRIMARY_PAREN
+                    && is_closed(self, node->expr));
+    }
+
+    return false;
+}
+
+// Turns node into literal, node keeps its span
+static void
+set_literal(Eps_Expression *node, Eps_Object literal)
+{
+    node->type = NODE_PRIMARY;
+    node->primary = PRIMARY_LIT;
+    node->literal = literal;
+}
+
+// Replaces node with its 'operand', expression roots carry span
+// of the whole expression, so non-literals are wrapped in parens
+static void
+replace(Optimizer *self, Eps_Expression *node, Eps_AstIndex operand)
+{
+    Eps_Expression *sub = EpsAst_Expr(self->ast, operand);
+
+    if (is_literal(sub)) {
+        // literal moves to the node
+        set_literal(node, sub->literal);
+        sub->literal = EpsObject_Void();
+    } else {
+        node->type = NODE_PRIMARY;
+        node->primary = PRIMARY_PAREN;
+        node->expr = operand;
+    }
+}
+
+// Evaluates operator on literals, returns false if it would fail
+static bool
+eval_binary(Eps_TokenType op, Eps_Object *left, Eps_Object *right,
+                                                Eps_Object *res)
+{
+    if (left->type == OBJ_REAL && right->type == OBJ_REAL) {
+        double lval = left->real;
+        double rval = right->real;
+
+        switch (op) {
+            case PLUS:          *res = EpsObject_Real(lval + rval);  break;
+            case MINUS:         *res = EpsObject_Real(lval - rval);  break;
+            case STAR:          *res = EpsObject_Real(lval * rval);  break;
+            case SLASH:         *res = EpsObject_Real(lval / rval);  break;
+            case EQUAL:         *res = EpsObject_Bool(lval == rval); break;
+            case BANG_EQUAL:    *res = EpsObject_Bool(lval != rval); break;
+            case LESS_EQUAL:    *res = EpsObject_Bool(lval <= rval); break;
+            case GREATER_EQUAL: *res = EpsObject_Bool(lval >= rval); break;
+            case LESS:          *res = EpsObject_Bool(lval < rval);  break;
+            case GREATER:       *res = EpsObject_Bool(lval > rval);  break;
+            default: return false;
+        }
+
+        return true;
+    }
+
+    if (left->type == OBJ_STRING && right->type == OBJ_STRING) {
+        switch (op) {
+            case PLUS:
+                *res = EpsObject_Concat(
+                    EpsObject_Clone(*left),
+                    EpsObject_Clone(*right)
+                );
+            break;
+            case EQUAL:
+                *res = EpsObject_Bool(EpsString_Equal(left->string, right->string));
+            break;
+            case BANG_EQUAL:
+                *res = EpsObject_Bool(!EpsString_Equal(left->string, right->string));
+            break;
+            default: return false;
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+static void
+fold_binary(Optimizer *self, Eps_Expression *node)
+{
+    Eps_Expression *left = EpsAst_Expr(self->ast, node->binary.left);
+    Eps_Expression *right = EpsAst_Expr(self->ast, node->binary.right);
+    Eps_Object res;
+
+    if (is_literal(left) && is_literal(right)) {
+        if (eval_binary(node->operator, &left->literal, &right->literal, &res))
+            set_literal(node, res);
+
+        return;
+    }
+
+    // x + 0 is left alone, it turns -0 into 0
+    switch (node->operator) {
+        case STAR:
+            if (is_real_literal(right, 1) && is_real(self, node->binary.left))
+                replace(self, node, node->binary.left);
+            else if (is_real_literal(left, 1) && is_real(self, node->binary.right))
+                replace(self, node, node->binary.right);
+        break;
+        case SLASH:
+            if (is_real_literal(right, 1) && is_real(self, node->binary.left))
+                replace(self, node, node->binary.left);
+        break;
+        case MINUS:
+            if (is_real_literal(right, 0) && is_real(self, node->binary.left))
+                replace(self, node, node->binary.left);
+        break;
+        default: break;
+    }
+}
+
+static void
+fold_unary(Optimizer *self, Eps_Expression *node)
+{
+    Eps_Expression *right = EpsAst_Expr(self->ast, node->unary.right);
+
+    if (!is_literal(right))
+        return;
+
+    switch (node->operator) {
+        case MINUS:
+            if (right->literal.type == OBJ_REAL)
+                set_literal(node, EpsObject_Real(-right->literal.real));
+        break;
+        case STR:
+            if (right->literal.type != OBJ_VOID)
+                set_literal(node, EpsObject_ToString(right->literal));
+        break;
+        default: break;
+    }
+}
+
+static void
+fold_ternary(Optimizer *self, Eps_Expression *node)
+{
+    Eps_Expression *cond = EpsAst_Expr(self->ast, node->ternary.cond);
+    Eps_AstIndex taken, dropped;
+
+    if (!is_literal(cond) || cond->literal.type != OBJ_BOOL)
+        return;
+
+    taken = cond->literal.boolean ? node->ternary.left : node->ternary.right;
+    dropped = cond->literal.boolean ? node->ternary.right : node->ternary.left;
+
+    if (is_closed(self, dropped))
+        replace(self, node, taken);
+}
+
+static void
+optimize_primary(Optimizer *self, Eps_Expression *node)
+{
+    switch (node->primary) {
+        case PRIMARY_LIT: break;
+        case PRIMARY_PAREN:
+        {
+            Eps_Expression *sub = EpsAst_Expr(self->ast, node->expr);
+
+            optimize_expr(self, node->expr);
+
+            if (is_literal(sub))
+                replace(self, node, node->expr);
+        } break;
+        case PRIMARY_CALL:
+        {
+            Eps_Call *call = EpsAst_Call(self->ast, node->call);
+            uint32_t i;
+
+            if (self->functions == 0)
+                self->called = true;
+
+            for (i = 0; i < call->args.length; i++) {
+                optimize_expr(self, EpsAst_ListGet(self->ast, call->args, i));
+            }
+        } break;
+        case PRIMARY_ID:
+        {
+            Global *global = find_global(self, node->var.name);
+
+            if (global != NULL && global->value.type != OBJ_UNDEFINED)
+                set_literal(node, EpsObject_Clone(global->value));
+        } break;
+    }
+}
+
+static void
+optimize_expr(Optimizer *self, Eps_AstIndex index)
+{
+    Eps_Expression *expr = EpsAst_Expr(self->ast, index);
+
+    switch (expr->type) {
+        case NODE_TERNARY:
+            optimize_expr(self, expr->ternary.cond);
+            optimize_expr(self, expr->ternary.left);
+            optimize_expr(self, expr->ternary.right);
+            fold_ternary(self, expr);
+        break;
+        case NODE_BIN:
+            optimize_expr(self, expr->binary.left);
+            optimize_expr(self, expr->binary.right);
+            fold_binary(self, expr);
+        break;
+        case NODE_UNARY:
+            optimize_expr(self, expr->unary.right);
+            fold_unary(self, expr);
+        break;
+        case NODE_PRIMARY:
+            optimize_primary(self, expr);
+        break;
+    }
+}
+
+// * - Statements -
+
+static void
+optimize_group(Optimizer *self, Eps_StatementGroup *group)
+{
+    size_t mark = self->length;
+    uint32_t i;
+
+    self->scopes++;
+
+    for (i = 0; i < group->stmts.length; i++) {
+        optimize_stmt(self, EpsAst_ListGet(self->ast, group->stmts, i));
+    }
+
+    self->scopes--;
+    self->length = mark;
+}
+
+static void
+optimize_func(Optimizer *self, Eps_StatementFunc *func)
+{
+    size_t mark, func_base = self->func_base;
+    uint32_t i;
+
+    if (self->scopes > 0)
+        declare_local(self, func->identifier.name, OBJ_UNDEFINED);
+
+    mark = self->length;
+
+    // arguments are not checked against any type
+    for (i = 0; i < func->params.length; i++) {
+        Eps_Param *param = EpsAst_Param(self->ast, func->params, i);
+
+        declare_local(self, param->identifier.name, OBJ_UNDEFINED);
+    }
+
+    self->func_base = mark;
+    self->functions++;
+    self->scopes++;
+    optimize_stmt(self, func->body);
+    self->scopes--;
+    self->functions--;
+    self->func_base = func_base;
+    self->length = mark;
+}
+
+static void
+optimize_stmt(Optimizer *self, Eps_AstIndex index)
+{
+    Eps_Statement *stmt = EpsAst_Stmt(self->ast, index);
+
+    switch (stmt->type) {
+        case S_EXPR:
+            optimize_expr(self, stmt->expr.expr);
+        break;
+        case S_GROUP:
+            optimize_group(self, &stmt->group);
+        break;
+        case S_OUTPUT:
+            optimize_expr(self, stmt->output.expr);
+        break;
+        case S_IF:
+            optimize_expr(self, stmt->conditional.cond);
+            self->conditional++;
+            optimize_stmt(self, stmt->conditional.body);
+
+            if (stmt->conditional._else != EPS_AST_NONE)
+                optimize_stmt(self, stmt->conditional._else);
+
+            self->conditional--;
+        break;
+        case S_FUNC:
+            optimize_func(self, &stmt->func);
+        break;
+        case S_RETURN:
+            if (stmt->ret.expr != EPS_AST_NONE)
+                optimize_expr(self, stmt->ret.expr);
+        break;
+        case S_CONST:
+            optimize_expr(self, stmt->define.expr);
+            define(self, &stmt->define, true);
+        break;
+        case S_DEFINE:
+            optimize_expr(self, stmt->define.expr);
+            define(self, &stmt->define, false);
+        break;
+        case S_ASSIGN:
+            optimize_expr(self, stmt->assign.expr);
+        break;
+    }
+}
+
+void
+Eps_Optimize(Eps_Ast *ast)
+{
+    _DEBUG("--------------- OPTIMIZER ---------------\n");
+
+    Eps_Optimizer *optimizer = EpsOptimizer_Create(ast);
+    uint32_t i;
+
+    for (i = 0; i < ast->program.length; i++) {
+        EpsOptimizer_Next(optimizer, EpsAst_ListGet(ast, ast->program, i));
+    }
+
+    EpsOptimizer_Destroy(optimizer);
+}
+
+Eps_Optimizer *
+EpsOptimizer_Create(Eps_Ast *ast)
+{
+    Eps_Optimizer *self = EpsMem_Alloc(sizeof(Eps_Optimizer));
+
+    memset(self, 0, sizeof(Eps_Optimizer));
+    self->ast = ast;
+    self->globals = EpsDict_Create();
+
+    return self;
+}
+
+void
+EpsOptimizer_Destroy(Eps_Optimizer *self)
+{
+    EpsDict_Destroy(self->globals, destroy_global);
+    EpsMem_Free(self->locals);
+    EpsMem_Free(self);
+}
+
+void
+EpsOptimizer_Next(Eps_Optimizer *self, Eps_AstIndex stmt)
+{
+    optimize_stmt(self, stmt);
+}
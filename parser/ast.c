@@ -0,0 +1,313 @@
+#include "parser.h"
+#include "core/memory.h"
+#include "core/errors.h"
+#include <string.h>
+#include <stdio.h>
+
+#define POOL_INIT_CAPACITY 64
+
+// Reserves room for one more item, returns its index
+static Eps_AstIndex
+pool_grow(void **items, uint32_t *length, uint32_t *capacity, size_t size)
+{
+    if (*length == *capacity) {
+        if (*capacity >= EPS_AST_NONE/2)
+            EpsErr_Fatal("program is too large");
+
+        *capacity = *capacity ? *capacity*2 : POOL_INIT_CAPACITY;
+        *items = EpsMem_Realloc(*items, size*(*capacity));
+    }
+
+    return (*length)++;
+}
+
+#define POOL_PUSH(pool) \
+    pool_grow( \
+        (void **)&(pool).items, \
+        &(pool).length, \
+        &(pool).capacity, \
+        sizeof(*(pool).items) \
+    )
+
+Eps_Ast *
+EpsAst_Create(void)
+{
+    Eps_Ast *ast = EpsMem_Alloc(sizeof(Eps_Ast));
+
+    memset(ast, 0, sizeof(Eps_Ast));
+
+    return ast;
+}
+
+// Releases string literals of the expressions starting from 'from'
+static void
+free_literals(Eps_Ast *ast, uint32_t from)
+{
+    uint32_t i;
+
+    for (i = from; i < ast->exprs.length; i++) {
+        Eps_Expression *expr = &ast->exprs.items[i];
+
+        if (expr->type == NODE_PRIMARY && expr->primary == PRIMARY_LIT)
+            EpsObject_Destroy(&expr->literal);
+
+#ifdef EPS_DBG
+        EpsMem_Free(expr->debug_string);
+#endif
+    }
+}
+
+void
+EpsAst_Destroy(Eps_Ast *ast)
+{
+    free_literals(ast, 0);
+
+    EpsMem_Free(ast->exprs.items);
+    EpsMem_Free(ast->stmts.items);
+    EpsMem_Free(ast->calls.items);
+    EpsMem_Free(ast->params.items);
+    EpsMem_Free(ast->lists.items);
+    EpsMem_Free(ast);
+}
+
+Eps_AstIndex
+EpsAst_AddExpr(Eps_Ast *ast, const Eps_Expression *expr)
+{
+    Eps_AstIndex index = POOL_PUSH(ast->exprs);
+
+    ast->exprs.items[index] = *expr;
+
+    return index;
+}
+
+Eps_AstIndex
+EpsAst_AddStmt(Eps_Ast *ast, const Eps_Statement *stmt)
+{
+    Eps_AstIndex index = POOL_PUSH(ast->stmts);
+
+    ast->stmts.items[index] = *stmt;
+
+    return index;
+}
+
+Eps_AstIndex
+EpsAst_AddCall(Eps_Ast *ast, const Eps_Call *call)
+{
+    Eps_AstIndex index = POOL_PUSH(ast->calls);
+
+    ast->calls.items[index] = *call;
+
+    return index;
+}
+
+Eps_AstIndex
+EpsAst_AddParam(Eps_Ast *ast, Eps_Param param)
+{
+    Eps_AstIndex index = POOL_PUSH(ast->params);
+
+    ast->params.items[index] = param;
+
+    return index;
+}
+
+Eps_AstList
+EpsAst_AddList(Eps_Ast *ast, const Eps_AstIndex *items, uint32_t length)
+{
+    Eps_AstList list = { ast->lists.length, length };
+    uint32_t i;
+
+    for (i = 0; i < length; i++) {
+        Eps_AstIndex index = POOL_PUSH(ast->lists);
+
+        ast->lists.items[index] = items[i];
+    }
+
+    return list;
+}
+
+Eps_AstMark
+EpsAst_Mark(const Eps_Ast *ast)
+{
+    Eps_AstMark mark = {
+        .exprs = ast->exprs.length,
+        .stmts = ast->stmts.length,
+        .calls = ast->calls.length,
+        .params = ast->params.length,
+        .lists = ast->lists.length,
+    };
+
+    return mark;
+}
+
+void
+EpsAst_Rewind(Eps_Ast *ast, Eps_AstMark mark)
+{
+    free_literals(ast, mark.exprs);
+
+    ast->exprs.length = mark.exprs;
+    ast->stmts.length = mark.stmts;
+    ast->calls.length = mark.calls;
+    ast->params.length = mark.params;
+    ast->lists.length = mark.lists;
+}
+
+// * - Dump -
+
+static void
+dump_expr(const Eps_Ast *ast, Eps_AstIndex index, FILE *out)
+{
+    Eps_Expression *expr = EpsAst_Expr(ast, index);
+
+    switch (expr->type) {
+        case NODE_TERNARY:
+            fputs("(?: ", out);
+            dump_expr(ast, expr->ternary.cond, out);
+            fputc(' ', out);
+            dump_expr(ast, expr->ternary.left, out);
+            fputc(' ', out);
+            dump_expr(ast, expr->ternary.right, out);
+            fputc(')', out);
+        break;
+        case NODE_BIN:
+            fprintf(out, "(%s ", Eps_GetTokenLexeme(expr->operator));
+            dump_expr(ast, expr->binary.left, out);
+            fputc(' ', out);
+            dump_expr(ast, expr->binary.right, out);
+            fputc(')', out);
+        break;
+        case NODE_UNARY:
+            fprintf(out, "(%s ", Eps_GetTokenLexeme(expr->operator));
+            dump_expr(ast, expr->unary.right, out);
+            fputc(')', out);
+        break;
+        case NODE_PRIMARY:
+        {
+            switch (expr->primary) {
+                case PRIMARY_LIT:
+                {
+                    switch (expr->literal.type) {
+                        case OBJ_REAL:
+                            fprintf(out, "%g", expr->literal.real);
+                        break;
+                        case OBJ_STRING:
+                            fprintf(out, "\"%s\"", expr->literal.string->chars);
+                        break;
+                        case OBJ_BOOL:
+                            fputs(expr->literal.boolean ? "true" : "false", out);
+                        break;
+                        default:
+                            fputs("void", out);
+                        break;
+                    }
+                } break;
+                case PRIMARY_PAREN:
+                    dump_expr(ast, expr->expr, out);
+                break;
+                case PRIMARY_CALL:
+                {
+                    Eps_Call *call = EpsAst_Call(ast, expr->call);
+                    uint32_t i;
+
+                    fprintf(out, "(call %s", call->identifier.name->str);
+
+                    for (i = 0; i < call->args.length; i++) {
+                        fputc(' ', out);
+                        dump_expr(ast, EpsAst_ListGet(ast, call->args, i), out);
+                    }
+
+                    fputc(')', out);
+                } break;
+                case PRIMARY_ID:
+                    fputs(expr->var.name->str, out);
+                break;
+            }
+        } break;
+    }
+}
+
+static void
+dump_stmt(const Eps_Ast *ast, Eps_AstIndex index, int depth, FILE *out)
+{
+    Eps_Statement *stmt = EpsAst_Stmt(ast, index);
+    uint32_t i;
+
+    fprintf(out, "%*s(", depth*2, "");
+
+    switch (stmt->type) {
+        case S_EXPR:
+            fputs("expr ", out);
+            dump_expr(ast, stmt->expr.expr, out);
+        break;
+        case S_GROUP:
+            fputs("group", out);
+
+            for (i = 0; i < stmt->group.stmts.length; i++) {
+                fputc('\n', out);
+                dump_stmt(ast, EpsAst_ListGet(ast, stmt->group.stmts, i),
+                          depth + 1, out);
+            }
+        break;
+        case S_FUNC:
+            fprintf(out, "func %s (", stmt->func.identifier.name->str);
+
+            for (i = 0; i < stmt->func.params.length; i++) {
+                fprintf(out, i ? " %s" : "%s",
+                        EpsAst_Param(ast, stmt->func.params, i)->identifier.name->str);
+            }
+
+            fprintf(out, ") %s\n", EpsDbg_GetObjectTypeString(stmt->func.type));
+            dump_stmt(ast, stmt->func.body, depth + 1, out);
+        break;
+        case S_RETURN:
+            fputs("return", out);
+
+            if (stmt->ret.expr != EPS_AST_NONE) {
+                fputc(' ', out);
+                dump_expr(ast, stmt->ret.expr, out);
+            }
+        break;
+        case S_CONST:
+        case S_DEFINE:
+            fprintf(
+                out,
+                "%s %s %s ",
+                stmt->type == S_CONST ? "const" : "let",
+                stmt->define.identifier.name->str,
+                EpsDbg_GetObjectTypeString(stmt->define.type)
+            );
+            dump_expr(ast, stmt->define.expr, out);
+        break;
+        case S_ASSIGN:
+            fprintf(out, "<- %s ", stmt->assign.identifier.name->str);
+            dump_expr(ast, stmt->assign.expr, out);
+        break;
+        case S_IF:
+            fputs("if ", out);
+            dump_expr(ast, stmt->conditional.cond, out);
+            fputc('\n', out);
+            dump_stmt(ast, stmt->conditional.body, depth + 1, out);
+
+            if (stmt->conditional._else != EPS_AST_NONE) {
+                fputc('\n', out);
+                dump_stmt(ast, stmt->conditional._else, depth + 1, out);
+            }
+        break;
+        case S_OUTPUT:
+            fputs("output ", out);
+            dump_expr(ast, stmt->output.expr, out);
+        break;
+    }
+
+    fputc(')', out);
+}
+
+void
+EpsAst_Dump(const Eps_Ast *ast, FILE *out)
+{
+    uint32_t i;
+
+    for (i = 0; i < ast->program.length; i++) {
+        dump_stmt(ast, EpsAst_ListGet(ast, ast->program, i), 0, out);
+        fputc('\n', out);
+    }
+}
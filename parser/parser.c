@@ -1,20 +1,37 @@
 #include "parser.h"
+#include "lexer/lexer.h"
 #include "core/object.h"
 #include "core/memory.h"
+#include "core/errors.h"
 #include "core/debug_macros.h"
-#include "core/ds/list.h"
+#include "core/symbol.h"
+#include "core/ds/dict.h"
 #include <stdbool.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdarg.h>
 
-typedef struct {
-    EpsList      *tokens;
-    EpsList      *statements;
+typedef struct Eps_Parser {
+    Eps_Input    *input; // token lexemes are read from it
+    Eps_TokenBuf *tokens;
+    Eps_Ast      *ast;   // nodes are added to it
 
-    Eps_Token    *current_tok;
-    EpsList_Node *current_node;
+    Eps_LexState  lexstate;
+    Eps_LexState *lexer;   // pulls tokens on demand, NULL once all are lexed
+    size_t        current; // index of the current token
+
+    // items of the lists being parsed, nested lists
+    // are stacked on top of the enclosing ones
+    Eps_AstIndex *stack;
+    size_t        stack_length;
+    size_t        stack_capacity;
+
+    // string literals by their text, equal literals share one string,
+    // NULL in stream mode, where the table would only grow
+    EpsDict      *literals;
+
+    size_t        stmt_start; // offset of the statement parsed last
 } Parser;
 
 // * - Core Debug Utils
@@ -38,15 +55,28 @@ _EpsDbg_GetStmtTypeString(Eps_StatementType stmt_type)
 }
 #endif
 
+// * - Utils -
+
+// Returns pointer to the token lexeme in the input,
+// note that it is not null-terminated
+static const char *
+lexeme(Parser *self, Eps_Token *token)
+{
+    return &self->input->raw[token->offset - self->input->base];
+}
+
 // * - Errors -
 
+static Eps_Token *
+current(Parser *self);
+
 static void
 syntax_error(Parser *self, const char format[], ...)
 {
     ERR_INSTANCE_INIT_BUFFER();
 
     EpsErr_Raise(
-        &self->current_tok->ls,
+        EpsToken_Span(current(self)),
         "Syntax Error",
         buffer
     );
@@ -55,47 +85,67 @@ syntax_error(Parser *self, const char format[], ...)
 static void
 syntax_error_expected(Parser *self, Eps_TokenType exp_tok)
 {
+    Eps_Token *tok = current(self);
+
     syntax_error(
         self,
-        "expected %s instead of '%s'",
+        "expected %s instead of '%.*s'",
         _EpsDbg_GetTokenTypeString(exp_tok),
-        self->current_tok->lexeme
+        (int)tok->length,
+        lexeme(self, tok)
     );
 }
 
-// * - Utils -
+// Returns token at 'index', tokens past the end are <EOF>.
+// Note that pulling a token may move the buffer.
+static Eps_Token *
+token_at(Parser *self, size_t index)
+{
+    while (index >= self->tokens->length && self->lexer != NULL) {
+        Eps_Token tok = Eps_LexToken(self->lexer);
+
+        EpsTokenBuf_Push(self->tokens, tok);
+
+        if (tok.toktype == T_EOF)
+            self->lexer = NULL;
+    }
+
+    if (index >= self->tokens->length)
+        index = self->tokens->length-1;
+
+    return &self->tokens->items[index];
+}
 
 // Returns Current Token
 static Eps_Token *
 current(Parser *self)
 {
-    self->current_tok = (Eps_Token*)self->current_node->data;
-
-    return self->current_tok;
+    return token_at(self, self->current);
 }
 
 // Returns Previous Token
 static Eps_Token *
 prev(Parser *self)
 {
-    return (Eps_Token *)self->current_node->prev->data;
+    return &self->tokens->items[self->current-1];
 }
 
 // Returns Next Token
 static Eps_Token *
 peek_next(Parser *self)
 {
-    return (Eps_Token *)self->current_node->next->data;
+    return token_at(self, self->current+1);
 }
 
 // Returns current token and shifts the pointer
-// to the next node.
+// to the next token, never moves past <EOF>.
 static Eps_Token *
 advance(Parser *self)
 {
     Eps_Token *t = current(self);
 
-    self->current_node = self->current_node->next;
+    if (t->toktype != T_EOF)
+        self->current++;
 
     return t;
 }
@@ -157,14 +207,7 @@ parse_required(Parser *self, Eps_TokenType tok)
 static bool
 lookahead(Parser *self, size_t n, Eps_TokenType tok)
 {
-    size_t i;
-    EpsList_Node *current = self->current_node;
-
-    for (i = 0; i < n; i++) {
-        current = current->next;
-    }
-
-    return ((Eps_Token *)current->data)->toktype == tok;
+    return token_at(self, self->current+n)->toktype == tok;
 }
 
 // Check if token is valid type specifier
@@ -183,120 +226,139 @@ is_type_specifier(Eps_TokenType tok)
 
 // * - Expressions Constructors -
 
-static Eps_Expression*
-create_expression()
+static Eps_AstIndex
+add_expr(Parser *self, const Eps_Expression *node)
 {
-    return EpsMem_Alloc(sizeof(Eps_Expression));
+    return EpsAst_AddExpr(self->ast, node);
 }
 
-static Eps_Expression *
-create_ternary_node(Eps_Expression *cond, Eps_Expression *left,
-                                          Eps_Expression *right)
+static Eps_AstIndex
+create_ternary_node(Parser *self, Eps_AstIndex cond,
+                    Eps_AstIndex left, Eps_AstIndex right)
 {
-    Eps_Expression* node = create_expression();
+    Eps_Expression node = { .type = NODE_TERNARY, .value_type = OBJ_ANY };
 
-    node->type = NODE_TERNARY;
-    node->ternary = EpsMem_Alloc(sizeof(Eps_AstTernaryNode));
-    node->ternary->cond = cond;
-    node->ternary->left = left;
-    node->ternary->right = right;
+    node.span = EpsAst_Expr(self->ast, left)->span;
+    node.ternary.cond = cond;
+    node.ternary.left = left;
+    node.ternary.right = right;
 
-    return node;
+    return add_expr(self, &node);
 }
 
-static Eps_Expression *
-create_bin_node(Eps_Token *operator, Eps_Expression *left,
-                                     Eps_Expression *right)
+static Eps_AstIndex
+create_bin_node(Parser *self, Eps_Token operator,
+                Eps_AstIndex left, Eps_AstIndex right)
 {
-    Eps_Expression* node = create_expression();
+    Eps_Expression node = { .type = NODE_BIN, .value_type = OBJ_ANY };
 
-    node->type = NODE_BIN;
-    node->binary = EpsMem_Alloc(sizeof(Eps_AstBinNode));
-    node->binary->operator = operator;
-    node->binary->left = left;
-    node->binary->right = right;
+    node.operator = operator.toktype;
+    node.span = EpsToken_Span(&operator);
+    node.binary.op_span = EpsToken_Span(&operator);
+    node.binary.left = left;
+    node.binary.right = right;
 
-    return node;
+    return add_expr(self, &node);
 }
 
-static Eps_Expression *
-create_unary_node(Eps_Token* operator, Eps_Expression *right)
+static Eps_AstIndex
+create_unary_node(Parser *self, Eps_Token operator, Eps_AstIndex right)
 {
-    Eps_Expression *node = create_expression();
+    Eps_Expression node = { .type = NODE_UNARY, .value_type = OBJ_ANY };
 
-    node->type = NODE_UNARY;
-    node->unary = EpsMem_Alloc(sizeof(Eps_AstUnaryNode));
-    node->unary->operator = operator;
-    node->unary->right = right;
+    node.operator = operator.toktype;
+    node.span = EpsToken_Span(&operator);
+    node.unary.op_span = EpsToken_Span(&operator);
+    node.unary.right = right;
 
-    return node;
+    return add_expr(self, &node);
 }
 
 // Primary
-static Eps_AstPrimaryNode *
-create_literal_node(Eps_Object *literal)
+static Eps_AstIndex
+create_literal_node(Parser *self, Eps_Object literal, Eps_SrcSpan span)
 {
-    Eps_AstPrimaryNode *node = EpsMem_Alloc(sizeof(Eps_AstPrimaryNode));
+    Eps_Expression node = {
+        .type = NODE_PRIMARY,
+        .primary = PRIMARY_LIT,
+        .value_type = OBJ_ANY
+    };
 
-    node->literal = literal;
-    node->type = PRIMARY_LIT;
+    node.span = span;
+    node.literal = literal;
 
-    return node;
+    return add_expr(self, &node);
 }
 
-static Eps_AstPrimaryNode *
-create_parenthesized_node(Eps_Expression *expr)
+static Eps_AstIndex
+create_parenthesized_node(Parser *self, Eps_AstIndex expr)
 {
-    Eps_AstPrimaryNode *node = EpsMem_Alloc(sizeof(Eps_AstPrimaryNode));
+    Eps_Expression node = {
+        .type = NODE_PRIMARY,
+        .primary = PRIMARY_PAREN,
+        .value_type = OBJ_ANY
+    };
 
-    node->expr = expr;
-    node->type = PRIMARY_PAREN;
+    node.span = EpsAst_Expr(self->ast, expr)->span;
+    node.expr = expr;
 
-    return node;
+    return add_expr(self, &node);
 }
 
-static Eps_AstPrimaryNode*
-create_identifier_node(Eps_Token *identifier)
+static Eps_AstIndex
+create_identifier_node(Parser *self, Eps_Identifier identifier)
 {
-    Eps_AstPrimaryNode* node = EpsMem_Alloc(sizeof(Eps_AstPrimaryNode));
+    Eps_Expression node = {
+        .type = NODE_PRIMARY,
+        .primary = PRIMARY_ID,
+        .value_type = OBJ_ANY
+    };
 
-    node->identifier = identifier;
-    node->type = PRIMARY_ID;
+    node.span = identifier.span;
+    node.var.name = identifier.name;
 
-    return node;
+    return add_expr(self, &node);
 }
 
-static Eps_AstPrimaryNode*
-create_call_node(Eps_Token *identifier, EpsList *args)
+static Eps_AstIndex
+create_call_node(Parser *self, Eps_Identifier identifier, Eps_AstList args)
 {
-    Eps_AstPrimaryNode* node = EpsMem_Alloc(sizeof(Eps_AstPrimaryNode));
-
-    node->type = PRIMARY_CALL;
-    node->func = EpsMem_Alloc(sizeof(Eps_Call));
-    node->func->identifier = identifier;
-    node->func->args = args;
-
-    return node;
+    Eps_Expression node = {
+        .type = NODE_PRIMARY,
+        .primary = PRIMARY_CALL,
+        .value_type = OBJ_ANY
+    };
+    Eps_Call call = {
+        .identifier = identifier,
+        .args = args,
+        .func = EPS_AST_NONE
+    };
+
+    node.span = identifier.span;
+    node.call = EpsAst_AddCall(self->ast, &call);
+
+    return add_expr(self, &node);
 }
 
 #ifdef EPS_DBG
 static char *
-expr_to_string(Eps_Expression *expr)
+expr_to_string(Parser *self, Eps_AstIndex index)
 {
+    Eps_Expression *expr = EpsAst_Expr(self->ast, index);
     char *result = EpsMem_Alloc(sizeof(char)*256);
 
     switch (expr->type) {
         case NODE_PRIMARY:
         {
-            switch (expr->primary->type) {
+            switch (expr->primary) {
                 case PRIMARY_LIT:
                 {
-                    switch (expr->primary->literal->type) {
+                    switch (expr->literal.type) {
                         case OBJ_BOOL:
                             sprintf(
                                 result,
                                 "%s",
-                                *(bool *)expr->primary->literal->value ?
+                                expr->literal.boolean ?
                                     "true": "false"
                             );
                         break;
@@ -304,29 +366,27 @@ expr_to_string(Eps_Expression *expr)
                             sprintf(
                                 result,
                                 "%f",
-                                *(double *)expr->primary->literal->value
+                                expr->literal.real
                             );
                         break;
                         case OBJ_STRING:
                             sprintf(
                                 result,
                                 "%s",
-                                (char *)expr->primary->literal->value
+                                expr->literal.string->chars
                             );
                         break;
+                        default:
+                            sprintf(result, "void");
+                        break;
                     }
-                    sprintf(
-                        result,
-                        "%f",
-                        *(double *)expr->primary->literal->value
-                    );
                 } break;
                 case PRIMARY_ID:
                 {
                     sprintf(
                         result,
                         "%s",
-                        expr->primary->identifier->lexeme
+                        expr->var.name->str
                     );
                 } break;
                 case PRIMARY_CALL:
@@ -334,11 +394,11 @@ expr_to_string(Eps_Expression *expr)
                     sprintf(
                         result,
                         "%s",
-                        expr->primary->func->identifier->lexeme
+                        EpsAst_Call(self->ast, expr->call)->identifier.name->str
                     );
                 } break;
                 default:
-                    return expr_to_string(expr->primary->expr);
+                    return expr_to_string(self, expr->expr);
             }
         } break;
         case NODE_UNARY:
@@ -346,8 +406,8 @@ expr_to_string(Eps_Expression *expr)
             sprintf(
                 result,
                 "(%s %s)",
-                _EpsDbg_GetTokenTypeString(expr->unary->operator->toktype),
-                expr_to_string(expr->unary->right)
+                _EpsDbg_GetTokenTypeString(expr->operator),
+                expr_to_string(self, expr->unary.right)
             );
         } break;
         case NODE_BIN:
@@ -355,9 +415,9 @@ expr_to_string(Eps_Expression *expr)
             sprintf(
                 result,
                 "(%s %s %s)",
-                expr_to_string(expr->binary->left),
-                _EpsDbg_GetTokenTypeString(expr->binary->operator->toktype),
-                expr_to_string(expr->binary->right)
+                expr_to_string(self, expr->binary.left),
+                _EpsDbg_GetTokenTypeString(expr->operator),
+                expr_to_string(self, expr->binary.right)
             );
         } break;
         case NODE_TERNARY:
@@ -365,9 +425,9 @@ expr_to_string(Eps_Expression *expr)
             sprintf(
                 result,
                 "(%s IF %s ELSE %s)",
-                expr_to_string(expr->ternary->left),
-                expr_to_string(expr->ternary->cond),
-                expr_to_string(expr->ternary->right)
+                expr_to_string(self, expr->ternary.left),
+                expr_to_string(self, expr->ternary.cond),
+                expr_to_string(self, expr->ternary.right)
             );
         } break;
         default:
@@ -378,35 +438,82 @@ expr_to_string(Eps_Expression *expr)
 }
 
 static void
-print_expression(Eps_Expression *expr)
+print_expression(Parser *self, Eps_AstIndex expr)
 {
-    printf("%s\n", expr_to_string(expr));
+    printf("%s\n", expr_to_string(self, expr));
 }
 #endif
 
 // * - Parsing Utils -
 
-// Parse string from token->lexeme
-static Eps_Object *
-parse_string(Eps_Token *token)
+// Parse identifier, interning its lexeme
+static Eps_Identifier
+parse_identifier(Parser *self)
 {
-    size_t len = strlen(token->lexeme)-2;
-    char *literal = EpsMem_Alloc(sizeof(char)*(len+1));
-    memcpy(literal, &token->lexeme[1], len);
-    token->lexeme[len+1] = '\0';
+    Eps_Token *token = advance(self);
+    Eps_Identifier identifier;
+
+    identifier.name = EpsSymbol_Intern(
+        lexeme(self, token),
+        token->length
+    );
+    identifier.span = EpsToken_Span(token);
 
-    return EpsObject_Create(OBJ_STRING, literal, false);
+    return identifier;
 }
 
-// Parse number from token->lexeme
-static Eps_Object *
-parse_number(Eps_Token *token)
+// Parse string from the token lexeme, interning it unless streaming
+static Eps_Object
+parse_string(Parser *self, Eps_Token *token)
 {
-    double *val = EpsMem_Alloc(sizeof(double));
+    // skipping the quotes
+    size_t len = token->length >= 2 ? token->length-2 : 0;
+    Eps_Symbol *text;
+    Eps_String *literal;
+
+    if (self->literals == NULL)
+        return EpsObject_String(EpsString_Create(lexeme(self, token)+1, len));
 
-    *val = strtod(token->lexeme, NULL);
+    text = EpsSymbol_Intern(lexeme(self, token)+1, len);
+    literal = EpsDict_Get(self->literals, text);
 
-    return EpsObject_Create(OBJ_REAL, val, false);
+    if (literal == NULL) {
+        literal = EpsString_Create(text->str, text->length);
+        literal->hash = text->hash;
+        EpsDict_Set(self->literals, text, literal);
+    }
+
+    return EpsObject_Clone(EpsObject_String(literal));
+}
+
+static void
+release_literal(void *literal)
+{
+    Eps_Object obj = EpsObject_String(literal);
+
+    EpsObject_Destroy(&obj);
+}
+
+// Parse number from the token lexeme
+static Eps_Object
+parse_number(Parser *self, Eps_Token *token)
+{
+    char buffer[64];
+    char *str = buffer;
+    double val;
+
+    // strtod needs the lexeme to be terminated
+    if (token->length >= sizeof(buffer))
+        str = EpsMem_Alloc(token->length+1);
+
+    memcpy(str, lexeme(self, token), token->length);
+    str[token->length] = '\0';
+    val = strtod(str, NULL);
+
+    if (str != buffer)
+        EpsMem_Free(str);
+
+    return EpsObject_Real(val);
 }
 
 // Parse type specifier
@@ -416,150 +523,187 @@ parse_type_spec(Eps_Token *token)
     switch (token->toktype) {
         case REAL:
             return OBJ_REAL;
+        case STR:
+            return OBJ_STRING;
+        case BOOL:
+            return OBJ_BOOL;
         default:
             return OBJ_VOID;
     }
 }
 
+// Starts a list, returns its base in the stack
+static size_t
+list_begin(Parser *self)
+{
+    return self->stack_length;
+}
+
+static void
+list_push(Parser *self, Eps_AstIndex index)
+{
+    if (self->stack_length == self->stack_capacity) {
+        self->stack_capacity = self->stack_capacity ? self->stack_capacity*2 : 64;
+        self->stack = EpsMem_Realloc(
+            self->stack,
+            sizeof(Eps_AstIndex)*self->stack_capacity
+        );
+    }
+
+    self->stack[self->stack_length++] = index;
+}
+
+// Moves list items from the stack to the tree
+static Eps_AstList
+list_end(Parser *self, size_t base)
+{
+    Eps_AstList list = EpsAst_AddList(
+        self->ast,
+        &self->stack[base],
+        self->stack_length - base
+    );
+
+    self->stack_length = base;
+
+    return list;
+}
+
 // * - Parsing Expressions -
 
-static Eps_Expression *
+static Eps_AstIndex
 expression(Parser *self);
 
-static Eps_AstPrimaryNode *
+static Eps_AstIndex
 parse_call(Parser *self)
 {
     // Function call matches following grammary:
     // call = identifier '(' args ')';
     // args = arg | (arg ',' args);
 
-    Eps_Token *identifier = advance(self);
-    EpsList *args = EpsList_Create();
+    Eps_Identifier identifier = parse_identifier(self);
+    size_t args = list_begin(self);
 
     parse_required(self, L_PAREN);
     while (!match(self, R_PAREN)) {
-        EpsList_Append(args, expression(self));
+        list_push(self, expression(self));
 
         if (!check(self, R_PAREN)) {
             parse_required(self, COMMA);
         }
     }
 
-    return create_call_node(identifier, args);
+    return create_call_node(self, identifier, list_end(self, args));
 }
 
-static Eps_Expression *
+static Eps_AstIndex
 primary(Parser *self)
 {
     if (match(self, T_EOF)) {
         EpsErr_Fatal("unexpected end of file");
-        return NULL;
+        return EPS_AST_NONE;
     }
 
-    Eps_Expression* expr = create_expression();
-    expr->type = NODE_PRIMARY;
+    Eps_SrcSpan span = EpsToken_Span(current(self));
 
     if (check(self, NUMBER)) {
-        expr->primary = create_literal_node(
-            parse_number(advance(self))
+        return create_literal_node(
+            self,
+            parse_number(self, advance(self)),
+            span
         );
     }
     else if(check(self, STRING)) {
-        expr->primary = create_literal_node(
-            parse_string(advance(self))
+        return create_literal_node(
+            self,
+            parse_string(self, advance(self)),
+            span
         );
     }
     else if(check(self, IDENTIFIER)) {
         if(lookahead(self, 1, L_PAREN))
-            expr->primary = parse_call(self);
+            return parse_call(self);
         else
-            expr->primary = create_identifier_node(advance(self));
+            return create_identifier_node(self, parse_identifier(self));
     }
     else if (match(self, VOID)) {
-        expr->primary = create_literal_node(NULL);
+        return create_literal_node(self, EpsObject_Void(), span);
     }
     else if (check(self, TRUE) || check(self, FALSE)) {
         Eps_Token* t = advance(self);
-        bool* val = EpsMem_Alloc(sizeof(bool));
-
-        if (t->toktype == TRUE) {
-            *val = true;
-        } else {
-            *val = false;
-        }
 
-        expr->primary = create_literal_node(
-            EpsObject_Create(OBJ_BOOL, val, false)
+        return create_literal_node(
+            self,
+            EpsObject_Bool(t->toktype == TRUE),
+            span
         );
     }
     else if (match(self, L_PAREN)) {
-        expr->primary = create_parenthesized_node(
+        Eps_AstIndex expr = create_parenthesized_node(
+            self,
             expression(self)
         );
+
         parse_required(self, R_PAREN);
-    }
-    else {
-        syntax_error(self, "expected expression");
+        return expr;
     }
 
-    return expr;
+    syntax_error(self, "expected expression");
+
+    // keep the tree walkable after the error
+    return create_literal_node(self, EpsObject_Void(), span);
 }
 
-static Eps_Expression*
+static Eps_AstIndex
 unary(Parser *self)
 {
     // unary = '-' primary;
     if (check(self, MINUS) || is_type_specifier(current(self)->toktype)) {
-        Eps_Expression* expr = create_expression();
+        Eps_Token operator = *advance(self);
+        Eps_AstIndex right = primary(self);
 
-        Eps_Token* operator = advance(self);
-        Eps_Expression* right = primary(self);
-
-        expr = create_unary_node(operator, right);
-
-        return expr;
+        return create_unary_node(self, operator, right);
     }
 
     return primary(self);
 }
 
-static Eps_Expression *
+static Eps_AstIndex
 factor(Parser *self)
 {
     // factor = unary (('*' | '/') unary)*;
-    Eps_Expression *expr = unary(self);
+    Eps_AstIndex expr = unary(self);
 
     while (check(self, STAR) || check(self, SLASH)) {
-        Eps_Token *operator = advance(self);
-        Eps_Expression *right = unary(self);
+        Eps_Token operator = *advance(self);
+        Eps_AstIndex right = unary(self);
 
-        expr = create_bin_node(operator, expr, right);
+        expr = create_bin_node(self, operator, expr, right);
     }
 
     return expr;
 }
 
-static Eps_Expression*
+static Eps_AstIndex
 term(Parser *self)
 {
     // term = factor (('+' | '-') factor)*;
-    Eps_Expression *expr = factor(self);
+    Eps_AstIndex expr = factor(self);
 
     while (check(self, PLUS) || check(self, MINUS)) {
-        Eps_Token *operator = advance(self);
-        Eps_Expression *right = factor(self);
+        Eps_Token operator = *advance(self);
+        Eps_AstIndex right = factor(self);
 
-        expr = create_bin_node(operator, expr, right);
+        expr = create_bin_node(self, operator, expr, right);
     }
 
     return expr;
 }
 
-static Eps_Expression *
+static Eps_AstIndex
 comparison(Parser *self)
 {
     // comparison = term (('=' | '<' | '>' | '<=' | '>=') term)*;
-    Eps_Expression *expr = term(self);
+    Eps_AstIndex expr = term(self);
 
     while (check(self, EQUAL)      ||
            check(self, LESS)       ||
@@ -567,71 +711,74 @@ comparison(Parser *self)
            check(self, LESS_EQUAL) ||
            check(self, GREATER_EQUAL)) {
 
-        Eps_Token *operator = advance(self);
-        Eps_Expression *right = term(self);
+        Eps_Token operator = *advance(self);
+        Eps_AstIndex right = term(self);
 
-        expr = create_bin_node(operator, expr, right);
+        expr = create_bin_node(self, operator, expr, right);
     }
 
     return expr;
 }
 
-static Eps_Expression *
+static Eps_AstIndex
 equality(Parser *self)
 {
     // equality = comparison (('!=' | '=') comparison)*;
 
-    Eps_Expression *expr = comparison(self);
+    Eps_AstIndex expr = comparison(self);
 
     while (check(self, BANG_EQUAL) ||
            check(self, EQUAL)) {
-        Eps_Token *operator = advance(self);
-        Eps_Expression *right = comparison(self);
+        Eps_Token operator = *advance(self);
+        Eps_AstIndex right = comparison(self);
 
-        expr = create_bin_node(operator, expr, right);
+        expr = create_bin_node(self, operator, expr, right);
     }
 
     return expr;
 }
 
-static Eps_Expression *
+static Eps_AstIndex
 ternary(Parser *self)
 {
     // ternary = equality 'if' equality 'else' ternary | equality;
-    Eps_Expression *left = equality(self);
+    Eps_AstIndex left = equality(self);
 
     if (match(self, IF)) {
     _DEBUG("ternary\n");
-        Eps_Expression *condition = equality(self);
+        Eps_AstIndex condition = equality(self);
 
         parse_required(self, ELSE);
-        return create_ternary_node(condition, left, ternary(self));
+        return create_ternary_node(self, condition, left, ternary(self));
     }
 
     return left;
 }
 
-static Eps_Expression *
+static Eps_AstIndex
 expression(Parser *self)
 {
-    Eps_Expression *expr;
-    Eps_LexState ls;
+    Eps_AstIndex expr;
+    Eps_SrcSpan span, last;
 
-    ls = current(self)->ls; // saving current token lexstate
-    expr = ternary(self);   // parsing
+    span = EpsToken_Span(current(self)); // saving first token location
+    expr = ternary(self);       // parsing
+    last = EpsToken_Span(prev(self));
 
     // include only one line of expression
-    if (prev(self)->ls.line == ls.line) {
+    if (last.offset + last.length > span.offset &&
+        memchr(&self->input->raw[span.offset - self->input->base], '\n',
+               last.offset + last.length - span.offset) == NULL) {
         // expression end is an enclosing token end
-        ls.end = prev(self)->ls.end;
+        span.length = last.offset + last.length - span.offset;
     }
-    expr->ls = ls; // attaching lexstate to the expression
+    EpsAst_Expr(self->ast, expr)->span = span; // attaching location to the expression
 
 #ifdef EPS_DBG
-    expr->debug_string = expr_to_string(expr);
+    EpsAst_Expr(self->ast, expr)->debug_string = expr_to_string(self, expr);
 #endif
 
-    _DEBUG("DEBUG STRING: %s\n", expr->debug_string);
+    _DEBUG("DEBUG STRING: %s\n", EpsAst_Expr(self->ast, expr)->debug_string);
 
     return expr;
 }
@@ -639,52 +786,53 @@ expression(Parser *self)
 
 // * - Parsing Statements -
 
-static Eps_Statement *
-create_statement(void)
+static Eps_AstIndex
+add_stmt(Parser *self, const Eps_Statement *stmt)
 {
-    return EpsMem_Alloc(sizeof(Eps_Statement));
+    return EpsAst_AddStmt(self->ast, stmt);
 }
 
-static Eps_Statement *
+static Eps_AstIndex
 statement(Parser *self);
 
-static Eps_Statement *
+static Eps_AstIndex
 stmt_group(Parser *self)
 {
     // Statement group matches following grammary:
     // group = '{' statement* '}';
 
-    Eps_Statement *stmt = create_statement();
+    Eps_Statement stmt = { .type = S_GROUP };
+    size_t stmts = list_begin(self);
 
-    stmt->type = S_GROUP;
-    stmt->group = EpsMem_Alloc(sizeof(Eps_StatementGroup));
-    stmt->group = EpsList_Create();
-
-    parse_required(self, L_BRACE);
+    stmt.group.brace = EpsToken_Span(parse_required(self, L_BRACE));
     while (!match(self, R_BRACE)) {
-        EpsList_Append(stmt->group, statement(self));
+        list_push(self, statement(self));
     }
-    return stmt;
+
+    stmt.group.stmts = list_end(self, stmts);
+    stmt.group.frame = false;
+    stmt.group.base = 0;
+    stmt.group.scope_size = 0;
+
+    return add_stmt(self, &stmt);
 }
 
-static Eps_Statement *
+static Eps_AstIndex
 stmt_expr(Parser *self)
 {
     // Expression statement matches following grammary:
     // stmt_expr = expression ';';
 
-    Eps_Statement *stmt = create_statement();
+    Eps_Statement stmt = { .type = S_EXPR };
 
-    stmt->type = S_EXPR;
-    stmt->expr = EpsMem_Alloc(sizeof(Eps_StatementExpr));
-    stmt->expr->expr = expression(self);
+    stmt.expr.expr = expression(self);
 
     parse_required(self, SEMICOLON);
 
-    return stmt;
+    return add_stmt(self, &stmt);
 }
 
-static Eps_Statement *
+static Eps_AstIndex
 stmt_func(Parser *self)
 {
     // Function definition statement matches following grammary:
@@ -692,104 +840,111 @@ stmt_func(Parser *self)
     // params = param | (param | "," params);
     // param  = identifier ':' type;
 
-    Eps_Statement *stmt = create_statement();
+    Eps_Statement stmt = { .type = S_FUNC };
 
-    stmt->type = S_FUNC;
-    stmt->func = EpsMem_Alloc(sizeof(Eps_StatementFunc));
-    stmt->func->keyword = parse_required(self, FUNC);
-    stmt->func->identifier = advance(self);
-    stmt->func->params = EpsList_Create();
+    stmt.func.keyword = EpsToken_Span(parse_required(self, FUNC));
+    stmt.func.identifier = parse_identifier(self);
+    // nothing else is added to the parameter pool meanwhile
+    stmt.func.params.start = self->ast->params.length;
 
     parse_required(self, L_PAREN);
 
     while (!match(self, R_PAREN)) {
-        EpsList_Append(stmt->func->params, advance(self));
+        Eps_Param param = { .identifier = parse_identifier(self) };
+        Eps_Token *type;
 
         parse_required(self, COLON);
-        advance(self);
+        type = advance(self);
+        // parameters of unknown types are not checked
+        param.type = is_type_specifier(type->toktype)
+            ? parse_type_spec(type)
+            : OBJ_ANY;
+        EpsAst_AddParam(self->ast, param);
 
         if (!check(self, R_PAREN)) {
             parse_required(self, COMMA);
         }
     }
 
+    stmt.func.params.length = self->ast->params.length - stmt.func.params.start;
+
     parse_required(self, ARROW_RIGHT);
 
     if(is_type_specifier(current(self)->toktype)) {
-        stmt->func->type = parse_type_spec(advance(self));
-        stmt->func->body = statement(self);
+        stmt.func.type = parse_type_spec(advance(self));
+        stmt.func.body = statement(self);
     } else {
+        Eps_Statement empty = { .type = S_GROUP };
+
         syntax_error(self, "expected function type specifier");
+
+        // keep the tree walkable after the error
+        stmt.func.type = OBJ_VOID;
+        stmt.func.body = add_stmt(self, &empty);
     }
 
-    return stmt;
+    return add_stmt(self, &stmt);
 }
 
-static Eps_Statement *
+static Eps_AstIndex
 stmt_return(Parser *self)
 {
     // Return statement matches following grammary:
     // return = 'return' expression ';';
 
-    Eps_Statement *stmt = create_statement();
+    Eps_Statement stmt = { .type = S_RETURN };
 
-    stmt->type = S_RETURN;
-    stmt->ret = EpsMem_Alloc(sizeof(Eps_StatementReturn));
-    stmt->ret->keyword = parse_required(self, RETURN);
+    stmt.ret.keyword = EpsToken_Span(parse_required(self, RETURN));
 
     if(!match(self, SEMICOLON)) {
-        stmt->ret->expr = expression(self);
+        stmt.ret.expr = expression(self);
         parse_required(self, SEMICOLON);
     } else {
-        stmt->ret->expr = NULL;
+        stmt.ret.expr = EPS_AST_NONE;
     }
 
-    return stmt;
+    return add_stmt(self, &stmt);
 }
 
-static Eps_Statement *
+static Eps_AstIndex
 stmt_const(Parser *self)
 {
     // Constant definition matches following grammary:
     // const = 'const' identifier ':' type_specifier '<-' expression ';';
 
-    Eps_Statement *stmt = create_statement();
+    Eps_Statement stmt = { .type = S_CONST };
 
-    stmt->type = S_CONST;
-    stmt->define = EpsMem_Alloc(sizeof(Eps_StatementVar));
-    stmt->define->keyword = parse_required(self, CONST);
-    stmt->define->identifier = advance(self);
+    stmt.define.keyword = EpsToken_Span(parse_required(self, CONST));
+    stmt.define.identifier = parse_identifier(self);
     parse_required(self, COLON);
-    stmt->define->type = parse_type_spec(advance(self));
+    stmt.define.type = parse_type_spec(advance(self));
     parse_required(self, ARROW_LEFT);
-    stmt->define->expr = expression(self);
+    stmt.define.expr = expression(self);
     parse_required(self, SEMICOLON);
 
-    return stmt;
+    return add_stmt(self, &stmt);
 }
 
-static Eps_Statement *
+static Eps_AstIndex
 stmt_define(Parser *self)
 {
     // Variable definition matches following grammary:
     // define = 'let' identifier ':' type_specifier '<-' expression ';';
 
-    Eps_Statement *stmt = create_statement();
+    Eps_Statement stmt = { .type = S_DEFINE };
 
-    stmt->type = S_DEFINE;
-    stmt->define = EpsMem_Alloc(sizeof(Eps_StatementVar));
-    stmt->define->keyword = parse_required(self, LET);
-    stmt->define->identifier = advance(self);
+    stmt.define.keyword = EpsToken_Span(parse_required(self, LET));
+    stmt.define.identifier = parse_identifier(self);
     parse_required(self, COLON);
-    stmt->define->type = parse_type_spec(advance(self));
+    stmt.define.type = parse_type_spec(advance(self));
     parse_required(self, ARROW_LEFT);
-    stmt->define->expr = expression(self);
+    stmt.define.expr = expression(self);
     parse_required(self, SEMICOLON);
 
-    return stmt;
+    return add_stmt(self, &stmt);
 }
 
-static Eps_Statement *
+static Eps_AstIndex
 stmt_assign(Parser *self)
 {
     // Variable assignment matches following grammary:
@@ -799,61 +954,57 @@ stmt_assign(Parser *self)
         return stmt_expr(self);
 
 
-    Eps_Statement *stmt = create_statement();
+    Eps_Statement stmt = { .type = S_ASSIGN };
 
-    stmt->type = S_ASSIGN;
-    stmt->assign = EpsMem_Alloc(sizeof(Eps_StatementVar));
-    stmt->assign->identifier = advance(self);
+    stmt.assign.identifier = parse_identifier(self);
+    stmt.assign.type = OBJ_ANY; // known once the variable is resolved
     parse_required(self, ARROW_LEFT);
-    stmt->assign->expr = expression(self);
+    stmt.assign.expr = expression(self);
     parse_required(self, SEMICOLON);
 
-    return stmt;
+    return add_stmt(self, &stmt);
 }
 
-static Eps_Statement *
+static Eps_AstIndex
 stmt_output(Parser *self)
 {
     // Output statement matches following grammary:
     // output = 'output' expression ';';
 
-    Eps_Statement *stmt = create_statement();
+    Eps_Statement stmt = { .type = S_OUTPUT };
 
-    stmt->type = S_OUTPUT;
-    stmt->output = EpsMem_Alloc(sizeof(Eps_StatementOutput));
-    stmt->output->keyword = parse_required(self, OUTPUT);
-    stmt->output->expr = expression(self);
+    stmt.output.keyword = EpsToken_Span(parse_required(self, OUTPUT));
+    stmt.output.expr = expression(self);
 
     parse_required(self, SEMICOLON);
 
-    return stmt;
+    return add_stmt(self, &stmt);
 }
 
-static Eps_Statement *
+static Eps_AstIndex
 stmt_if(Parser *self)
 {
     // If statement matches following grammary:
     // if = 'if' expression statement;
 
-    Eps_Statement *stmt = create_statement();
+    Eps_Statement stmt = { .type = S_IF };
 
-    stmt->type = S_IF;
-    stmt->conditional = EpsMem_Alloc(sizeof(Eps_StatementConditional));
-    stmt->conditional->keyword = parse_required(self, IF);
-    stmt->conditional->cond = expression(self);
-    stmt->conditional->body = statement(self);
+    stmt.conditional.keyword = EpsToken_Span(parse_required(self, IF));
+    stmt.conditional.cond = expression(self);
+    stmt.conditional.body = statement(self);
+    stmt.conditional._else = EPS_AST_NONE;
 
     if (match(self, ELSE)) {
-        stmt->conditional->_else = statement(self);
+        stmt.conditional._else = statement(self);
     }
 
-    return stmt;
+    return add_stmt(self, &stmt);
 }
 
-static Eps_Statement *
+static Eps_AstIndex
 statement(Parser *self)
 {
-    Eps_Statement *stmt;
+    Eps_AstIndex stmt;
 
     switch (current(self)->toktype) {
         case L_BRACE:
@@ -894,26 +1045,122 @@ statement(Parser *self)
         }
     }
 
-    _DEBUG("<STMT TYPE=%s>\n", _EpsDbg_GetStmtTypeString(stmt->type));
+    _DEBUG(
+        "<STMT TYPE=%s>\n",
+        _EpsDbg_GetStmtTypeString(EpsAst_Stmt(self->ast, stmt)->type)
+    );
 
     return stmt;
 }
 
-EpsList *
-Eps_Parse(EpsList *tokens)
+Eps_Ast *
+Eps_Parse(Eps_Input *input, Eps_TokenBuf *tokens)
 {
 
     _DEBUG("----------------- PARSER: -----------------\n");
 
     Parser self;
+    self.input = input;
     self.tokens = tokens;
-    self.current_node = tokens->head;
-    self.statements = EpsList_Create();
-    self.current_tok = NULL;
+    self.ast = EpsAst_Create();
+    self.lexer = NULL;
+    self.current = 0;
+    self.stack = NULL;
+    self.stack_length = 0;
+    self.stack_capacity = 0;
+    self.literals = EpsDict_Create();
+    self.stmt_start = 0;
+
+    size_t program = list_begin(&self);
 
     while (current(&self)->toktype != T_EOF) {
-        EpsList_Append(self.statements, statement(&self));
+        list_push(&self, statement(&self));
     }
 
-    return self.statements;
+    self.ast->program = list_end(&self, program);
+    EpsMem_Free(self.stack);
+    EpsDict_Destroy(self.literals, release_literal);
+
+    return self.ast;
+}
+
+Eps_Parser *
+EpsParser_Create(Eps_Input *input)
+{
+    Eps_Parser *self = EpsMem_Alloc(sizeof(Eps_Parser));
+
+    self->input = input;
+    self->tokens = EpsTokenBuf_Create();
+    self->ast = EpsAst_Create();
+    self->current = 0;
+    self->stack = NULL;
+    self->stack_length = 0;
+    self->stack_capacity = 0;
+    self->literals = NULL;
+    self->stmt_start = 0;
+
+    Eps_LexInit(&self->lexstate, input);
+    self->lexer = &self->lexstate;
+
+    return self;
+}
+
+void
+EpsParser_Destroy(Eps_Parser *self)
+{
+    EpsTokenBuf_Destroy(self->tokens);
+    EpsAst_Destroy(self->ast);
+    EpsMem_Free(self->stack);
+    EpsMem_Free(self);
+}
+
+Eps_Ast *
+EpsParser_Ast(Eps_Parser *self)
+{
+    return self->ast;
+}
+
+Eps_AstIndex
+EpsParser_Next(Eps_Parser *self)
+{
+    // tokens of parsed statements are dropped,
+    // the last one is kept for synchronization
+    if (self->current > 1) {
+        size_t drop = self->current - 1;
+
+        memmove(
+            self->tokens->items,
+            &self->tokens->items[drop],
+            sizeof(Eps_Token)*(self->tokens->length - drop)
+        );
+        self->tokens->length -= drop;
+        self->current -= drop;
+    }
+
+    // blank lines and comments before the next statement are
+    // not needed, unless its first token is already read
+    if (self->current == self->tokens->length && self->lexer != NULL)
+        self->lexer->discard = true;
+
+    if (current(self)->toktype == T_EOF)
+        return EPS_AST_NONE;
+
+    // source of the parsed statements is not needed anymore
+    Eps_DiscardInput(self->input, self->tokens->items[0].offset);
+
+    self->stmt_start = current(self)->offset;
+
+    return statement(self);
+}
+
+void
+EpsParser_KeepSource(Eps_Parser *self)
+{
+    Eps_Token *last = prev(self);
+
+    Eps_KeepInput(
+        self->input,
+        self->stmt_start,
+        last->offset + last->length
+    );
 }
@@ -0,0 +1,180 @@
+#include "vm/bytecode.h"
+#include "core/memory.h"
+#include <stdio.h>
+#include <string.h>
+
+#define INITIAL_CAPACITY 64
+
+void
+EpsChunk_Init(Eps_Chunk *chunk)
+{
+    chunk->code = NULL;
+    chunk->locs = NULL;
+    chunk->length = 0;
+    chunk->capacity = 0;
+    chunk->constants = NULL;
+    chunk->const_count = 0;
+    chunk->const_capacity = 0;
+}
+
+void
+EpsChunk_Write(Eps_Chunk *chunk, uint8_t byte, Eps_SrcSpan loc)
+{
+    if (chunk->length == chunk->capacity) {
+        chunk->capacity = chunk->capacity ? chunk->capacity*2 : INITIAL_CAPACITY;
+        chunk->code = EpsMem_Realloc(chunk->code, chunk->capacity);
+        chunk->locs = EpsMem_Realloc(
+            chunk->locs,
+            sizeof(Eps_SrcSpan)*chunk->capacity
+        );
+    }
+
+    chunk->code[chunk->length] = byte;
+    chunk->locs[chunk->length] = loc;
+    chunk->length++;
+}
+
+size_t
+EpsChunk_AddConst(Eps_Chunk *chunk, Eps_Object val)
+{
+    if (chunk->const_count == chunk->const_capacity) {
+        chunk->const_capacity = chunk->const_capacity ?
+            chunk->const_capacity*2 : INITIAL_CAPACITY;
+        chunk->constants = EpsMem_Realloc(
+            chunk->constants,
+            sizeof(Eps_Object)*chunk->const_capacity
+        );
+    }
+
+    chunk->constants[chunk->const_count] = val;
+
+    return chunk->const_count++;
+}
+
+void
+EpsChunk_Free(Eps_Chunk *chunk)
+{
+    size_t i;
+
+    for (i = 0; i < chunk->const_count; i++) {
+        EpsObject_Destroy(&chunk->constants[i]);
+    }
+
+    EpsMem_Free(chunk->code);
+    EpsMem_Free(chunk->locs);
+    EpsMem_Free(chunk->constants);
+    EpsChunk_Init(chunk);
+}
+
+Eps_Function *
+EpsFunction_Create(char *name)
+{
+    Eps_Function *func = EpsMem_Alloc(sizeof(Eps_Function));
+
+    func->name = name;
+    func->arity = 0;
+    func->max_stack = 0;
+    func->level = 0;
+    func->type = OBJ_VOID;
+    EpsChunk_Init(&func->chunk);
+
+    return func;
+}
+
+void
+EpsProgram_Destroy(Eps_Program *program)
+{
+    size_t i;
+
+    for (i = 0; i < program->func_count; i++) {
+        EpsChunk_Free(&program->functions[i]->chunk);
+        EpsMem_Free(program->functions[i]);
+    }
+
+    EpsMem_Free(program->functions);
+    EpsMem_Free(program->global_names);
+    EpsMem_Free(program);
+}
+
+// * - Core Debug Utils
+#ifdef EPS_DBG
+static const char * _EpsDbg_OpCodeStrings[] = {
+    "CONST",
+    "VOID",
+    "POP",
+    "POPN",
+    "GET_LOCAL",
+    "SET_LOCAL",
+    "GET_OUTER",
+    "SET_OUTER",
+    "DEFINE_GLOBAL",
+    "GET_GLOBAL",
+    "SET_GLOBAL",
+    "CHECK_TYPE",
+    "ADD",
+    "SUB",
+    "MUL",
+    "DIV",
+    "EQUAL",
+    "NOT_EQUAL",
+    "LESS",
+    "LESS_EQUAL",
+    "GREATER",
+    "GREATER_EQUAL",
+    "NEGATE",
+    "TO_STRING",
+    "JUMP",
+    "JUMP_IF_FALSE",
+    "CALL",
+    "RETURN",
+    "RETURN_VOID",
+    "OUTPUT",
+};
+
+const char *
+_EpsDbg_GetOpCodeString(Eps_OpCode op)
+{
+    return _EpsDbg_OpCodeStrings[op];
+}
+
+// Returns number of operand bytes following the opcode
+static size_t
+operands_size(Eps_OpCode op)
+{
+    switch (op) {
+        case OP_POPN: case OP_GET_LOCAL: case OP_SET_LOCAL:
+            return 1;
+        case OP_CONST: case OP_DEFINE_GLOBAL: case OP_GET_GLOBAL:
+        case OP_SET_GLOBAL: case OP_CHECK_TYPE: case OP_JUMP:
+        case OP_GET_OUTER: case OP_SET_OUTER:
+        case OP_JUMP_IF_FALSE: case OP_CALL:
+            return 2;
+        default:
+            return 0;
+    }
+}
+
+void
+_EpsDbg_ChunkDump(Eps_Function *func)
+{
+    Eps_Chunk *chunk = &func->chunk;
+    size_t offset = 0;
+    size_t i;
+
+    printf("== %s ==\n", func->name);
+
+    while (offset < chunk->length) {
+        Eps_OpCode op = chunk->code[offset];
+        size_t n = operands_size(op);
+
+        printf("%04lu %-16s", offset, _EpsDbg_GetOpCodeString(op));
+
+        for (i = 1; i <= n; i++) {
+            printf(" %3u", chunk->code[offset + i]);
+        }
+
+        printf("\n");
+        offset += n + 1;
+    }
+}
+#endif
@@ -0,0 +1,994 @@
+#include "vm/compiler.h"
+#include "vm/bytecode.h"
+#include "parser.h"
+#include "ast.h"
+#include "core/ds/dict.h"
+#include "core/errors.h"
+#include "core/memory.h"
+#include "core/debug_macros.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <stdint.h>
+
+#define MAX_SLOTS   256    // local slots are addressed by a byte
+#define MAX_SHORT   65535  // constants, globals, functions and jumps
+#define NO_LOC      ((Eps_SrcSpan){ 0, 0 }) // code which never fails
+
+typedef enum {
+    BIND_VAR = 0,
+    BIND_FUNC,
+} BindingKind;
+
+typedef struct {
+    Eps_Symbol     *name;
+    BindingKind     kind;
+    Eps_ObjectType  type;
+    bool            mut;
+    size_t          index; // stack slot, global slot or function index
+    int             depth; // scope depth the binding belongs to
+} Binding;
+
+typedef struct {
+    Binding *items;
+    size_t   length;
+    size_t   capacity;
+} Bindings;
+
+// State of the function being compiled
+typedef struct func_state {
+    struct func_state *enclosing;
+    Eps_Function      *func;
+    Bindings           locals;
+
+    size_t slot_count;  // locals living on the stack
+    size_t stack_depth; // current stack depth relative to the frame
+    int    scope_depth;
+} FuncState;
+
+typedef struct {
+    const Eps_Ast *ast;
+    FuncState *current;
+    Bindings   globals;
+    EpsDict   *global_index; // name -> position in 'globals' + 1
+
+    Eps_Function **functions;
+    size_t         func_count;
+    size_t         func_capacity;
+    size_t         global_slots;
+} Compiler;
+
+// * - Errors -
+
+static void
+compile_error(Compiler *self, Eps_SrcSpan span, const char format[], ...)
+{
+    ERR_INSTANCE_INIT_BUFFER();
+
+    EpsErr_Raise(span, "Compile Error", buffer);
+}
+
+// * - Bindings -
+
+static Binding *
+bindings_add(Bindings *bindings, Eps_Symbol *name, BindingKind kind)
+{
+    Binding *b;
+
+    if (bindings->length == bindings->capacity) {
+        bindings->capacity = bindings->capacity ? bindings->capacity*2 : 16;
+        bindings->items = EpsMem_Realloc(
+            bindings->items,
+            sizeof(Binding)*bindings->capacity
+        );
+    }
+
+    b = &bindings->items[bindings->length++];
+    b->name = name;
+    b->kind = kind;
+    b->type = OBJ_VOID;
+    b->mut = true;
+    b->index = 0;
+    b->depth = 0;
+
+    return b;
+}
+
+// Find the innermost binding named 'name' with depth >= 'min_depth'
+static Binding *
+bindings_find(Bindings *bindings, Eps_Symbol *name, int min_depth)
+{
+    size_t i = bindings->length;
+
+    while (i-- > 0) {
+        Binding *b = &bindings->items[i];
+
+        if (b->depth < min_depth)
+            break;
+
+        if (b->name == name)
+            return b;
+    }
+
+    return NULL;
+}
+
+static Binding *
+find_global(Compiler *self, Eps_Symbol *name)
+{
+    uintptr_t pos = (uintptr_t)EpsDict_Get(self->global_index, name);
+
+    return pos ? &self->globals.items[pos-1] : NULL;
+}
+
+static Binding *
+add_global(Compiler *self, Eps_Symbol *name, BindingKind kind)
+{
+    Binding *b = bindings_add(&self->globals, name, kind);
+
+    EpsDict_Set(
+        self->global_index,
+        name,
+        (void *)(uintptr_t)self->globals.length
+    );
+
+    return b;
+}
+
+static bool
+is_global_scope(Compiler *self)
+{
+    return self->current->enclosing == NULL
+        && self->current->scope_depth == 0;
+}
+
+// * - Emitting -
+
+static Eps_Chunk *
+current_chunk(Compiler *self)
+{
+    return &self->current->func->chunk;
+}
+
+static void
+adjust_stack(Compiler *self, int effect)
+{
+    FuncState *fs = self->current;
+
+    fs->stack_depth += effect;
+
+    if (fs->stack_depth > fs->func->max_stack)
+        fs->func->max_stack = fs->stack_depth;
+}
+
+static void
+emit_byte(Compiler *self, uint8_t byte, Eps_SrcSpan loc)
+{
+    EpsChunk_Write(current_chunk(self), byte, loc);
+}
+
+static void
+emit_short(Compiler *self, uint16_t val, Eps_SrcSpan loc)
+{
+    emit_byte(self, (val >> 8) & 0xff, loc);
+    emit_byte(self, val & 0xff, loc);
+}
+
+// Emit opcode that changes the stack depth by 'effect'
+static void
+emit_op(Compiler *self, Eps_OpCode op, int effect, Eps_SrcSpan loc)
+{
+    emit_byte(self, op, loc);
+    adjust_stack(self, effect);
+}
+
+static void
+emit_pops(Compiler *self, size_t n)
+{
+    while (n > 0) {
+        size_t chunk = n > 255 ? 255 : n;
+
+        if (chunk == 1) {
+            emit_op(self, OP_POP, -1, NO_LOC);
+        } else {
+            emit_op(self, OP_POPN, -(int)chunk, NO_LOC);
+            emit_byte(self, chunk, NO_LOC);
+        }
+
+        n -= chunk;
+    }
+}
+
+static void
+emit_const(Compiler *self, Eps_Object val, Eps_SrcSpan loc)
+{
+    size_t idx = EpsChunk_AddConst(current_chunk(self), val);
+
+    if (idx > MAX_SHORT) {
+        compile_error(self, loc, "too many constants in one function");
+    }
+
+    emit_op(self, OP_CONST, 1, loc);
+    emit_short(self, idx, loc);
+}
+
+// Emit jump with a placeholder offset, returns offset to patch
+static size_t
+emit_jump(Compiler *self, Eps_OpCode op, int effect, Eps_SrcSpan loc)
+{
+    emit_op(self, op, effect, loc);
+    emit_short(self, 0xffff, loc);
+
+    return current_chunk(self)->length - 2;
+}
+
+static void
+patch_jump(Compiler *self, size_t offset)
+{
+    Eps_Chunk *chunk = current_chunk(self);
+    size_t jump = chunk->length - offset - 2;
+
+    if (jump > MAX_SHORT) {
+        compile_error(self, chunk->locs[offset], "too much code to jump over");
+    }
+
+    chunk->code[offset] = (jump >> 8) & 0xff;
+    chunk->code[offset + 1] = jump & 0xff;
+}
+
+// * - Scopes -
+
+static void
+begin_scope(Compiler *self)
+{
+    self->current->scope_depth++;
+}
+
+static void
+end_scope(Compiler *self)
+{
+    FuncState *fs = self->current;
+    size_t slots = 0;
+
+    fs->scope_depth--;
+
+    while (fs->locals.length > 0 &&
+           fs->locals.items[fs->locals.length-1].depth > fs->scope_depth) {
+        if (fs->locals.items[fs->locals.length-1].kind == BIND_VAR)
+            slots++;
+
+        fs->locals.length--;
+    }
+
+    fs->slot_count -= slots;
+    emit_pops(self, slots);
+}
+
+static Eps_Function *
+add_function(Compiler *self, char *name)
+{
+    Eps_Function *func = EpsFunction_Create(name);
+
+    if (self->func_count == self->func_capacity) {
+        self->func_capacity = self->func_capacity ? self->func_capacity*2 : 16;
+        self->functions = EpsMem_Realloc(
+            self->functions,
+            sizeof(Eps_Function *)*self->func_capacity
+        );
+    }
+
+    self->functions[self->func_count++] = func;
+
+    return func;
+}
+
+// Declares a local variable living in the next stack slot
+static Binding *
+declare_local(Compiler *self, Eps_Identifier *identifier)
+{
+    FuncState *fs = self->current;
+    Binding *b;
+
+    if (fs->slot_count >= MAX_SLOTS) {
+        compile_error(
+            self,
+            identifier->span,
+            "too many local variables in function"
+        );
+    }
+
+    b = bindings_add(&fs->locals, identifier->name, BIND_VAR);
+    b->index = fs->slot_count++;
+    b->depth = fs->scope_depth;
+
+    return b;
+}
+
+// Binding found by 'resolve'
+typedef struct {
+    Binding *binding;
+    bool     global;
+    size_t   hops; // number of functions between the use and the local
+} Resolved;
+
+static Resolved
+resolve(Compiler *self, Eps_Identifier *identifier)
+{
+    Resolved res = { NULL, false, 0 };
+    FuncState *fs;
+
+    for (fs = self->current; fs != NULL; fs = fs->enclosing, res.hops++) {
+        Binding *b = bindings_find(&fs->locals, identifier->name, 0);
+
+        if (b == NULL) continue;
+
+        // locals of enclosing functions are reached by static links
+        if (b->kind == BIND_VAR && res.hops > UINT8_MAX) {
+            compile_error(
+                self,
+                identifier->span,
+                "'%s' is defined too many functions away",
+                identifier->name->str
+            );
+        }
+
+        res.binding = b;
+        return res;
+    }
+
+    res.binding = find_global(self, identifier->name);
+    res.global = true;
+
+    return res;
+}
+
+// * - Compiling Expressions -
+
+static void
+compile_expr(Compiler *self, Eps_AstIndex expr);
+
+// Returns location of the expression
+static Eps_SrcSpan
+expr_span(Compiler *self, Eps_AstIndex expr)
+{
+    return EpsAst_Expr(self->ast, expr)->span;
+}
+
+static void
+compile_call(Compiler *self, Eps_Call *call)
+{
+    Resolved res = resolve(self, &call->identifier);
+    const Eps_StatementFunc *decl = NULL;
+    size_t argc = call->args.length;
+    size_t i;
+
+    // arguments the type checker could not check are checked at runtime
+    if (!call->checked && call->func != EPS_AST_NONE)
+        decl = &EpsAst_Stmt(self->ast, call->func)->func;
+
+    for (i = 0; i < argc; i++) {
+        Eps_AstIndex arg = EpsAst_ListGet(self->ast, call->args, i);
+        Eps_Param *param;
+
+        compile_expr(self, arg);
+
+        if (decl == NULL || i >= decl->params.length)
+            continue;
+
+        param = EpsAst_Param(self->ast, decl->params, i);
+
+        if (param->type != OBJ_ANY) {
+            emit_op(self, OP_CHECK_TYPE, 0, expr_span(self, arg));
+            emit_byte(self, param->type, expr_span(self, arg));
+            emit_byte(self, CHECK_PARAM, expr_span(self, arg));
+        }
+    }
+
+    if (res.binding == NULL) {
+        compile_error(
+            self,
+            call->identifier.span,
+            "call undefined function '%s'",
+            call->identifier.name->str
+        );
+        return;
+    }
+
+    if (res.binding->kind != BIND_FUNC) {
+        compile_error(
+            self,
+            call->identifier.span,
+            "'%s' is not a function",
+            call->identifier.name->str
+        );
+        return;
+    }
+
+    Eps_Function *func = self->functions[res.binding->index];
+
+    if (argc < func->arity) {
+        compile_error(
+            self,
+            call->identifier.span,
+            "too few arguments in function '%s' call",
+            call->identifier.name->str
+        );
+    } else if (argc > func->arity) {
+        compile_error(
+            self,
+            call->identifier.span,
+            "too many arguments in '%s' function call",
+            call->identifier.name->str
+        );
+    }
+
+    emit_op(self, OP_CALL, 1 - (int)argc, call->identifier.span);
+    emit_short(self, res.binding->index, call->identifier.span);
+}
+
+static void
+compile_identifier(Compiler *self, Eps_Identifier *identifier)
+{
+    Resolved res = resolve(self, identifier);
+
+    if (res.binding == NULL) {
+        compile_error(
+            self,
+            identifier->span,
+            "reference to undefined name '%s'",
+            identifier->name->str
+        );
+    } else if (res.binding->kind == BIND_FUNC) {
+        compile_error(
+            self,
+            identifier->span,
+            "cannot use function '%s' as a value",
+            identifier->name->str
+        );
+    } else if (res.global) {
+        emit_op(self, OP_GET_GLOBAL, 1, identifier->span);
+        emit_short(self, res.binding->index, identifier->span);
+        return;
+    } else if (res.hops > 0) {
+        emit_op(self, OP_GET_OUTER, 1, identifier->span);
+        emit_byte(self, res.hops, identifier->span);
+        emit_byte(self, res.binding->index, identifier->span);
+        return;
+    } else {
+        emit_op(self, OP_GET_LOCAL, 1, identifier->span);
+        emit_byte(self, res.binding->index, identifier->span);
+        return;
+    }
+
+    // keep the stack balanced after an error
+    emit_op(self, OP_VOID, 1, identifier->span);
+}
+
+static void
+compile_primary(Compiler *self, Eps_Expression *node)
+{
+    Eps_SrcSpan span = node->span;
+
+    switch (node->primary) {
+        case PRIMARY_LIT:
+        {
+            if (node->literal.type == OBJ_VOID) {
+                emit_op(self, OP_VOID, 1, span);
+            } else {
+                emit_const(self, EpsObject_Clone(node->literal), span);
+            }
+        } break;
+        case PRIMARY_PAREN:
+        {
+            compile_expr(self, node->expr);
+        } break;
+        case PRIMARY_CALL:
+        {
+            compile_call(self, EpsAst_Call(self->ast, node->call));
+        } break;
+        case PRIMARY_ID:
+        {
+            Eps_Identifier identifier = { node->var.name, node->span };
+
+            compile_identifier(self, &identifier);
+        } break;
+    }
+}
+
+static void
+compile_unary(Compiler *self, Eps_Expression *node)
+{
+    compile_expr(self, node->unary.right);
+
+    switch (node->operator) {
+        case MINUS:
+            emit_op(self, OP_NEGATE, 0, node->unary.op_span);
+        break;
+        case STR:
+            emit_op(self, OP_TO_STRING, 0, node->unary.op_span);
+        break;
+        default:
+        {
+            compile_error(
+                self,
+                node->unary.op_span,
+                "unknown operator '%s'",
+                Eps_GetTokenLexeme(node->operator)
+            );
+        }
+    }
+}
+
+static void
+compile_binary(Compiler *self, Eps_Expression *node)
+{
+    Eps_OpCode op;
+
+    compile_expr(self, node->binary.left);
+    compile_expr(self, node->binary.right);
+
+    switch (node->operator) {
+        case PLUS:          op = OP_ADD;           break;
+        case MINUS:         op = OP_SUB;           break;
+        case STAR:          op = OP_MUL;           break;
+        case SLASH:         op = OP_DIV;           break;
+        case EQUAL:         op = OP_EQUAL;         break;
+        case BANG_EQUAL:    op = OP_NOT_EQUAL;     break;
+        case LESS:          op = OP_LESS;          break;
+        case LESS_EQUAL:    op = OP_LESS_EQUAL;    break;
+        case GREATER:       op = OP_GREATER;       break;
+        case GREATER_EQUAL: op = OP_GREATER_EQUAL; break;
+        default:
+        {
+            compile_error(
+                self,
+                node->binary.op_span,
+                "unknown operator '%s'",
+                Eps_GetTokenLexeme(node->operator)
+            );
+            op = OP_ADD;
+        }
+    }
+
+    emit_op(self, op, -1, node->binary.op_span);
+}
+
+static void
+compile_ternary(Compiler *self, Eps_Expression *node)
+{
+    size_t else_jump, end_jump;
+
+    compile_expr(self, node->ternary.cond);
+    else_jump = emit_jump(self, OP_JUMP_IF_FALSE, -1, node->span);
+
+    compile_expr(self, node->ternary.left);
+    end_jump = emit_jump(self, OP_JUMP, 0, node->span);
+    adjust_stack(self, -1); // only one of the branches is evaluated
+
+    patch_jump(self, else_jump);
+    compile_expr(self, node->ternary.right);
+    patch_jump(self, end_jump);
+}
+
+static void
+compile_expr(Compiler *self, Eps_AstIndex index)
+{
+    Eps_Expression *expr = EpsAst_Expr(self->ast, index);
+
+    switch (expr->type) {
+        case NODE_TERNARY:
+            compile_ternary(self, expr);
+        break;
+        case NODE_BIN:
+            compile_binary(self, expr);
+        break;
+        case NODE_UNARY:
+            compile_unary(self, expr);
+        break;
+        case NODE_PRIMARY:
+            compile_primary(self, expr);
+        break;
+    }
+}
+
+// * - Compiling Statements -
+
+static void
+compile_stmt(Compiler *self, Eps_AstIndex stmt);
+
+static void
+declare_global(Compiler *self, Eps_AstIndex index);
+
+// Compile unbraced branch of 'if' in the enclosing scope, like
+// the interpreter does; at the top level it declares globals
+static void
+compile_branch(Compiler *self, Eps_AstIndex stmt)
+{
+    if (is_global_scope(self))
+        declare_global(self, stmt);
+
+    compile_stmt(self, stmt);
+}
+
+static void
+compile_function(Compiler *self, Eps_StatementFunc *stmt, Eps_Function *func)
+{
+    FuncState fs = {0};
+    size_t i;
+
+    fs.enclosing = self->current;
+    fs.func = func;
+    self->current = &fs;
+
+    func->type = stmt->type;
+
+    for (i = 0; i < stmt->params.length; i++) {
+        Eps_Param *param = EpsAst_Param(self->ast, stmt->params, i);
+        Eps_Identifier *identifier = &param->identifier;
+
+        if (bindings_find(&fs.locals, identifier->name, 0) != NULL) {
+            compile_error(
+                self,
+                identifier->span,
+                "duplicate parameter '%s'",
+                identifier->name->str
+            );
+        }
+
+        declare_local(self, identifier);
+        adjust_stack(self, 1);
+    }
+
+    compile_stmt(self, stmt->body);
+    emit_op(self, OP_RETURN_VOID, 0, stmt->keyword);
+
+    EpsMem_Free(fs.locals.items);
+    self->current = fs.enclosing;
+
+#ifdef EPS_DBG
+    _EpsDbg_ChunkDump(func);
+#endif
+}
+
+static void
+compile_func(Compiler *self, Eps_StatementFunc *stmt)
+{
+    Binding *b;
+
+    // top-level functions are declared ahead of time
+    if (is_global_scope(self)) {
+        b = find_global(self, stmt->identifier.name);
+        compile_function(self, stmt, self->functions[b->index]);
+        return;
+    }
+
+    if (bindings_find(&self->current->locals, stmt->identifier.name,
+                      self->current->scope_depth) != NULL) {
+        compile_error(
+            self,
+            stmt->identifier.span,
+            "function '%s' is already defined",
+            stmt->identifier.name->str
+        );
+    }
+
+    // bind the name before the body to allow recursion
+    b = bindings_add(&self->current->locals, stmt->identifier.name, BIND_FUNC);
+    b->depth = self->current->scope_depth;
+    b->index = self->func_count;
+
+    Eps_Function *func = add_function(self, stmt->identifier.name->str);
+    func->arity = stmt->params.length;
+    func->level = self->current->func->level + 1;
+
+    compile_function(self, stmt, func);
+}
+
+static void
+compile_define(Compiler *self, Eps_StatementVar *stmt, bool mut)
+{
+    Eps_CheckKind check = mut ? CHECK_DEFINE : CHECK_CONST;
+
+    if (is_global_scope(self)) {
+        Binding *b = find_global(self, stmt->identifier.name);
+
+        compile_expr(self, stmt->expr);
+        emit_op(self, OP_CHECK_TYPE, 0, stmt->identifier.span);
+        emit_byte(self, stmt->type, stmt->identifier.span);
+        emit_byte(self, check, stmt->identifier.span);
+        emit_op(self, OP_DEFINE_GLOBAL, -1, stmt->identifier.span);
+        emit_short(self, b->index, stmt->identifier.span);
+        return;
+    }
+
+    if (bindings_find(&self->current->locals, stmt->identifier.name,
+                      self->current->scope_depth) != NULL) {
+        compile_error(
+            self,
+            stmt->identifier.span,
+            "%s '%s' is already defined",
+            mut ? "variable" : "constant",
+            stmt->identifier.name->str
+        );
+    }
+
+    // the value left on the stack becomes the local
+    compile_expr(self, stmt->expr);
+    emit_op(self, OP_CHECK_TYPE, 0, stmt->identifier.span);
+    emit_byte(self, stmt->type, stmt->identifier.span);
+    emit_byte(self, check, stmt->identifier.span);
+
+    Binding *b = declare_local(self, &stmt->identifier);
+    b->type = stmt->type;
+    b->mut = mut;
+}
+
+static void
+compile_assign(Compiler *self, Eps_StatementVar *stmt)
+{
+    Resolved res = resolve(self, &stmt->identifier);
+
+    compile_expr(self, stmt->expr);
+
+    if (res.binding == NULL || res.binding->kind != BIND_VAR) {
+        compile_error(
+            self,
+            stmt->identifier.span,
+            "variable '%s' is not defined",
+            stmt->identifier.name->str
+        );
+    } else if (!res.binding->mut) {
+        compile_error(
+            self,
+            stmt->identifier.span,
+            "cannot assign value to const '%s'",
+            stmt->identifier.name->str
+        );
+    } else if (res.global) {
+        emit_op(self, OP_SET_GLOBAL, -1, stmt->identifier.span);
+        emit_short(self, res.binding->index, stmt->identifier.span);
+        return;
+    } else if (res.hops > 0) {
+        emit_op(self, OP_SET_OUTER, -1, stmt->identifier.span);
+        emit_byte(self, res.hops, stmt->identifier.span);
+        emit_byte(self, res.binding->index, stmt->identifier.span);
+        return;
+    } else {
+        emit_op(self, OP_SET_LOCAL, -1, stmt->identifier.span);
+        emit_byte(self, res.binding->index, stmt->identifier.span);
+        return;
+    }
+
+    emit_op(self, OP_POP, -1, stmt->identifier.span);
+}
+
+static void
+compile_return(Compiler *self, Eps_StatementReturn *stmt)
+{
+    if (self->current->enclosing == NULL) {
+        compile_error(
+            self,
+            stmt->keyword,
+            "cannot return outside of the function"
+        );
+    }
+
+    if (stmt->expr != EPS_AST_NONE) {
+        compile_expr(self, stmt->expr);
+        emit_op(self, OP_RETURN, -1, expr_span(self, stmt->expr));
+    } else {
+        emit_op(self, OP_RETURN_VOID, 0, stmt->keyword);
+    }
+}
+
+// Fill slots of the 'n' locals declared by the branch which is
+// not taken, so the locals declared later keep their slots
+static void
+emit_skipped_locals(Compiler *self, size_t n, Eps_SrcSpan loc)
+{
+    // the other path left these slots on the stack
+    adjust_stack(self, -(int)n);
+
+    while (n-- > 0)
+        emit_op(self, OP_VOID, 1, loc);
+}
+
+static void
+compile_if(Compiler *self, Eps_StatementConditional *stmt)
+{
+    size_t slots = self->current->slot_count;
+    size_t else_jump, end_jump, body_slots, else_slots;
+
+    compile_expr(self, stmt->cond);
+    else_jump = emit_jump(self, OP_JUMP_IF_FALSE, -1, expr_span(self, stmt->cond));
+    compile_branch(self, stmt->body);
+    body_slots = self->current->slot_count - slots;
+
+    if (stmt->_else == EPS_AST_NONE && body_slots == 0) {
+        patch_jump(self, else_jump);
+        return;
+    }
+
+    end_jump = emit_jump(self, OP_JUMP, 0, stmt->keyword);
+    patch_jump(self, else_jump);
+    emit_skipped_locals(self, body_slots, stmt->keyword);
+
+    if (stmt->_else != EPS_AST_NONE)
+        compile_branch(self, stmt->_else);
+
+    else_slots = self->current->slot_count - slots - body_slots;
+
+    if (else_slots > 0) {
+        size_t skip_jump = emit_jump(self, OP_JUMP, 0, stmt->keyword);
+
+        patch_jump(self, end_jump);
+        emit_skipped_locals(self, else_slots, stmt->keyword);
+        end_jump = skip_jump;
+    }
+
+    patch_jump(self, end_jump);
+}
+
+static void
+compile_group(Compiler *self, Eps_StatementGroup *group)
+{
+    size_t i;
+
+    begin_scope(self);
+
+    for (i = 0; i < group->stmts.length; i++) {
+        compile_stmt(self, EpsAst_ListGet(self->ast, group->stmts, i));
+    }
+
+    end_scope(self);
+}
+
+static void
+compile_stmt(Compiler *self, Eps_AstIndex index)
+{
+    Eps_Statement *stmt = EpsAst_Stmt(self->ast, index);
+
+    switch (stmt->type) {
+        case S_EXPR:
+        {
+            compile_expr(self, stmt->expr.expr);
+            emit_op(self, OP_POP, -1, expr_span(self, stmt->expr.expr));
+        } break;
+        case S_GROUP:
+            compile_group(self, &stmt->group);
+        break;
+        case S_OUTPUT:
+        {
+            compile_expr(self, stmt->output.expr);
+            emit_op(self, OP_OUTPUT, -1, expr_span(self, stmt->output.expr));
+        } break;
+        case S_IF:
+            compile_if(self, &stmt->conditional);
+        break;
+        case S_FUNC:
+            compile_func(self, &stmt->func);
+        break;
+        case S_RETURN:
+            compile_return(self, &stmt->ret);
+        break;
+        case S_CONST:
+            compile_define(self, &stmt->define, false);
+        break;
+        case S_DEFINE:
+            compile_define(self, &stmt->define, true);
+        break;
+        case S_ASSIGN:
+            compile_assign(self, &stmt->assign);
+        break;
+    }
+}
+
+// Bind the name declared by a global statement
+static void
+declare_global(Compiler *self, Eps_AstIndex index)
+{
+    Eps_Statement *stmt = EpsAst_Stmt(self->ast, index);
+    Eps_Identifier *identifier;
+    Binding *b;
+
+    switch (stmt->type) {
+        case S_FUNC:  identifier = &stmt->func.identifier;   break;
+        case S_CONST:
+        case S_DEFINE: identifier = &stmt->define.identifier; break;
+        default: return;
+    }
+
+    if (find_global(self, identifier->name) != NULL) {
+        compile_error(
+            self,
+            identifier->span,
+            "'%s' is already defined",
+            identifier->name->str
+        );
+        return;
+    }
+
+    if (stmt->type == S_FUNC) {
+        Eps_Function *func = add_function(self, identifier->name->str);
+
+        b = add_global(self, identifier->name, BIND_FUNC);
+        b->index = self->func_count - 1;
+        func->arity = stmt->func.params.length;
+        func->level = 1;
+    } else {
+        b = add_global(self, identifier->name, BIND_VAR);
+        b->index = self->global_slots++;
+        b->type = stmt->define.type;
+        b->mut = stmt->type == S_DEFINE;
+    }
+
+    if (self->func_count > MAX_SHORT || self->global_slots > MAX_SHORT) {
+        compile_error(self, identifier->span, "too many global names");
+    }
+}
+
+// Declare top-level names ahead of time, so functions can
+// refer to each other and to globals defined later
+static void
+declare_globals(Compiler *self, Eps_AstList stmts)
+{
+    size_t i;
+
+    for (i = 0; i < stmts.length; i++) {
+        declare_global(self, EpsAst_ListGet(self->ast, stmts, i));
+    }
+}
+
+Eps_Program *
+Eps_Compile(const Eps_Ast *ast)
+{
+    _DEBUG("---------------- COMPILER ----------------\n");
+
+    Compiler self = {0};
+    FuncState script = {0};
+    Eps_Program *program;
+    size_t i;
+
+    self.ast = ast;
+    self.global_index = EpsDict_Create();
+    script.func = add_function(&self, "<script>");
+    self.current = &script;
+
+    declare_globals(&self, ast->program);
+
+    for (i = 0; i < ast->program.length; i++) {
+        compile_stmt(&self, EpsAst_ListGet(ast, ast->program, i));
+    }
+
+    emit_op(&self, OP_RETURN_VOID, 0, NO_LOC);
+    EpsMem_Free(script.locals.items);
+
+#ifdef EPS_DBG
+    _EpsDbg_ChunkDump(script.func);
+#endif
+
+    program = EpsMem_Alloc(sizeof(Eps_Program));
+    program->functions = self.functions;
+    program->func_count = self.func_count;
+    program->global_count = self.global_slots;
+    program->global_names = EpsMem_Alloc(
+        sizeof(char *)*(self.global_slots ? self.global_slots : 1)
+    );
+
+    for (i = 0; i < self.globals.length; i++) {
+        Binding *b = &self.globals.items[i];
+
+        if (b->kind == BIND_VAR)
+            program->global_names[b->index] = b->name->str;
+    }
+
+    EpsDict_Destroy(self.global_index, NULL);
+    EpsMem_Free(self.globals.items);
+
+    if (EpsErr_WasError()) {
+        EpsProgram_Destroy(program);
+        return NULL;
+    }
+
+    return program;
+}
@@ -0,0 +1,693 @@
+#include "vm/vm.h"
+#include "vm/bytecode.h"
+#include "interpreter/runtime_errors.h"
+#include "core/memory.h"
+#include "core/errors.h"
+#include "core/debug_macros.h"
+#include <stdio.h>
+#include <string.h>
+
+// Initial size of the stacks, they grow up to the max depth
+#define STACK_INIT  1024
+#define FRAMES_INIT 64
+
+// Use computed goto dispatch where the compiler supports it
+#if defined(__GNUC__) && !defined(EPS_NO_COMPUTED_GOTO)
+#   define EPS_COMPUTED_GOTO
+#endif
+
+typedef struct {
+    Eps_Function *func;
+    uint8_t      *ip;
+    Eps_Object   *slots;
+    size_t        link; // frame of the function the callee is defined in
+} CallFrame;
+
+typedef struct {
+    Eps_Program *program;
+
+    CallFrame   *frames;
+    size_t       frame_count;
+    size_t       frame_capacity;
+    size_t       max_depth;
+
+    Eps_Object  *stack;
+    Eps_Object  *sp;
+    size_t       stack_capacity;
+
+    Eps_Object  *globals;
+    bool        *defined;
+} VM;
+
+static const char * type_check_strings[] = {
+    "variable",
+    "const",
+    "parameter",
+};
+
+// * - Utils -
+
+// Strings are the only values owning memory, so check the
+// type here to keep the common case free of calls
+static Eps_Object
+value_clone(Eps_Object val)
+{
+    if (val.type == OBJ_STRING)
+        return EpsObject_Clone(val);
+
+    return val;
+}
+
+static void
+value_free(Eps_Object val)
+{
+    if (val.type == OBJ_STRING)
+        EpsObject_Destroy(&val);
+}
+
+static void
+output(Eps_Object val)
+{
+    switch (val.type) {
+        case OBJ_STRING:
+            printf("%s\n", val.string->chars);
+        break;
+        case OBJ_REAL:
+            printf("%f\n", val.real);
+        break;
+        case OBJ_BOOL:
+            printf("%s\n", val.boolean ? "true" : "false");
+        break;
+        default: break;
+    }
+}
+
+static const char *
+binary_op_string(Eps_OpCode op)
+{
+    switch (op) {
+        case OP_SUB:           return "-";
+        case OP_MUL:           return "*";
+        case OP_DIV:           return "/";
+        case OP_EQUAL:         return "=";
+        case OP_NOT_EQUAL:     return "!=";
+        case OP_LESS:          return "<";
+        case OP_LESS_EQUAL:    return "<=";
+        case OP_GREATER:       return ">";
+        case OP_GREATER_EQUAL: return ">=";
+        default:               return "+";
+    }
+}
+
+// Compares strings, releasing both of them
+static Eps_Object
+compare_strings(Eps_Object left, Eps_Object right, bool equal)
+{
+    bool res = EpsString_Equal(left.string, right.string) == equal;
+
+    value_free(left);
+    value_free(right);
+
+    return EpsObject_Bool(res);
+}
+
+static void
+binary_error(Eps_SrcSpan loc, Eps_OpCode op, Eps_Object *left,
+                                               Eps_Object *right)
+{
+    if (left->type == OBJ_STRING && right->type == OBJ_STRING) {
+        EpsErr_RuntimeError(
+            loc,
+            "cannot apply '%s' to arguments type 'string'",
+            binary_op_string(op)
+        );
+    } else {
+        EpsErr_RuntimeError(
+            loc,
+            "cannot apply binary operator to operands type '%s' and '%s'",
+            EpsDbg_GetObjectTypeString(left->type),
+            EpsDbg_GetObjectTypeString(right->type)
+        );
+    }
+}
+
+// * - Stack -
+
+// Grows frames and the value stack, so a frame taking 'size' slots
+// fits above 'sp'. Returns moved 'sp' or NULL if max depth is reached.
+static Eps_Object *
+grow_stack(VM *vm, Eps_Object *sp, size_t size)
+{
+    size_t used = sp - vm->stack;
+    Eps_Object *prev = vm->stack;
+    size_t i;
+
+    // the first frame runs the script, it is not a call
+    if (vm->frame_count > vm->max_depth)
+        return NULL;
+
+    if (vm->frame_count == vm->frame_capacity) {
+        vm->frame_capacity *= 2;
+
+        if (vm->frame_capacity > vm->max_depth + 1)
+            vm->frame_capacity = vm->max_depth + 1;
+
+        vm->frames = EpsMem_Realloc(
+            vm->frames,
+            sizeof(CallFrame)*vm->frame_capacity
+        );
+    }
+
+    if (used + size <= vm->stack_capacity)
+        return sp;
+
+    while (used + size > vm->stack_capacity) {
+        vm->stack_capacity *= 2;
+    }
+
+    vm->stack = EpsMem_Realloc(
+        vm->stack,
+        sizeof(Eps_Object)*vm->stack_capacity
+    );
+
+    // frames refer to their slots on the stack
+    for (i = 0; i < vm->frame_count; i++) {
+        vm->frames[i].slots = vm->stack + (vm->frames[i].slots - prev);
+    }
+
+    return vm->stack + used;
+}
+
+// * - Static Links -
+
+// Finds frame of the function a function of 'level' is defined in,
+// following static links from the calling frame 'from'
+static size_t
+defining_frame(VM *vm, size_t from, size_t level)
+{
+    while (vm->frames[from].func->level >= level)
+        from = vm->frames[from].link;
+
+    return from;
+}
+
+// Returns frame of the function enclosing the current one 'hops' times
+static CallFrame *
+enclosing_frame(VM *vm, CallFrame *frame, uint8_t hops)
+{
+    while (hops-- > 0)
+        frame = &vm->frames[frame->link];
+
+    return frame;
+}
+
+// * - Running -
+
+static void
+run(VM *vm)
+{
+    CallFrame *frame = &vm->frames[0];
+    Eps_Object *stack_end = vm->stack + vm->stack_capacity;
+    Eps_Function **functions = vm->program->functions;
+
+    // cached frame state
+    register uint8_t *ip = frame->ip;
+    register Eps_Object *sp = vm->sp;
+    Eps_Object *slots = frame->slots;
+    Eps_Object *constants = frame->func->chunk.constants;
+
+#define READ_BYTE()  (*ip++)
+#define READ_SHORT() (ip += 2, (uint16_t)((ip[-2] << 8) | ip[-1]))
+#define PUSH(val)    (*sp++ = (val))
+#define POP()        (*--sp)
+#define PEEK(n)      (sp[-1 - (n)])
+#define LOC()        (frame->func->chunk.locs[ip - frame->func->chunk.code - 1])
+
+#define LOAD_FRAME() \
+    do { \
+        frame = &vm->frames[vm->frame_count - 1]; \
+        ip = frame->ip; \
+        slots = frame->slots; \
+        constants = frame->func->chunk.constants; \
+    } while (0)
+
+#define RUNTIME_ERROR(...) \
+    do { \
+        EpsErr_RuntimeError(LOC(), __VA_ARGS__); \
+        goto unwind; \
+    } while (0)
+
+#define BINARY_REAL(op, res_type, res_field, c_op) \
+    do { \
+        if (PEEK(0).type != OBJ_REAL || PEEK(1).type != OBJ_REAL) { \
+            binary_error(LOC(), op, &PEEK(1), &PEEK(0)); \
+            goto unwind; \
+        } \
+        sp--; \
+        sp[-1].res_field = sp[-1].real c_op sp[0].real; \
+        sp[-1].type = res_type; \
+    } while (0)
+
+#ifdef EPS_COMPUTED_GOTO
+    // Warning: do not change the order, must match Eps_OpCode
+    static void *dispatch_table[] = {
+        &&do_OP_CONST,
+        &&do_OP_VOID,
+        &&do_OP_POP,
+        &&do_OP_POPN,
+        &&do_OP_GET_LOCAL,
+        &&do_OP_SET_LOCAL,
+        &&do_OP_GET_OUTER,
+        &&do_OP_SET_OUTER,
+        &&do_OP_DEFINE_GLOBAL,
+        &&do_OP_GET_GLOBAL,
+        &&do_OP_SET_GLOBAL,
+        &&do_OP_CHECK_TYPE,
+        &&do_OP_ADD,
+        &&do_OP_SUB,
+        &&do_OP_MUL,
+        &&do_OP_DIV,
+        &&do_OP_EQUAL,
+        &&do_OP_NOT_EQUAL,
+        &&do_OP_LESS,
+        &&do_OP_LESS_EQUAL,
+        &&do_OP_GREATER,
+        &&do_OP_GREATER_EQUAL,
+        &&do_OP_NEGATE,
+        &&do_OP_TO_STRING,
+        &&do_OP_JUMP,
+        &&do_OP_JUMP_IF_FALSE,
+        &&do_OP_CALL,
+        &&do_OP_RETURN,
+        &&do_OP_RETURN_VOID,
+        &&do_OP_OUTPUT,
+    };
+
+#   define DISPATCH()  goto *dispatch_table[READ_BYTE()]
+#   define CASE(op)    do_##op:
+#   define NEXT()      DISPATCH()
+
+    DISPATCH();
+#else
+#   define CASE(op)    case op:
+#   define NEXT()      continue
+
+    for (;;) switch (READ_BYTE()) {
+#endif
+
+    CASE(OP_CONST)
+    {
+        PUSH(value_clone(constants[READ_SHORT()]));
+        NEXT();
+    }
+    CASE(OP_VOID)
+    {
+        sp->type = OBJ_VOID;
+        sp++;
+        NEXT();
+    }
+    CASE(OP_POP)
+    {
+        value_free(POP());
+        NEXT();
+    }
+    CASE(OP_POPN)
+    {
+        uint8_t n = READ_BYTE();
+
+        while (n-- > 0)
+            value_free(POP());
+
+        NEXT();
+    }
+    CASE(OP_GET_LOCAL)
+    {
+        PUSH(value_clone(slots[READ_BYTE()]));
+        NEXT();
+    }
+    CASE(OP_SET_LOCAL)
+    {
+        Eps_Object *ref = &slots[READ_BYTE()];
+
+        if (ref->type != PEEK(0).type) {
+            RUNTIME_ERROR(
+                "cannot assign '%s' to variable type '%s'",
+                EpsDbg_GetObjectTypeString(PEEK(0).type),
+                EpsDbg_GetObjectTypeString(ref->type)
+            );
+        }
+
+        value_free(*ref);
+        *ref = POP();
+        NEXT();
+    }
+    CASE(OP_GET_OUTER)
+    {
+        CallFrame *outer = enclosing_frame(vm, frame, READ_BYTE());
+
+        PUSH(value_clone(outer->slots[READ_BYTE()]));
+        NEXT();
+    }
+    CASE(OP_SET_OUTER)
+    {
+        CallFrame *outer = enclosing_frame(vm, frame, READ_BYTE());
+        Eps_Object *ref = &outer->slots[READ_BYTE()];
+
+        if (ref->type != PEEK(0).type) {
+            RUNTIME_ERROR(
+                "cannot assign '%s' to variable type '%s'",
+                EpsDbg_GetObjectTypeString(PEEK(0).type),
+                EpsDbg_GetObjectTypeString(ref->type)
+            );
+        }
+
+        value_free(*ref);
+        *ref = POP();
+        NEXT();
+    }
+    CASE(OP_DEFINE_GLOBAL)
+    {
+        uint16_t idx = READ_SHORT();
+
+        vm->globals[idx] = POP();
+        vm->defined[idx] = true;
+        NEXT();
+    }
+    CASE(OP_GET_GLOBAL)
+    {
+        uint16_t idx = READ_SHORT();
+
+        if (!vm->defined[idx]) {
+            RUNTIME_ERROR(
+                "reference to undefined name '%s'",
+                vm->program->global_names[idx]
+            );
+        }
+
+        PUSH(value_clone(vm->globals[idx]));
+        NEXT();
+    }
+    CASE(OP_SET_GLOBAL)
+    {
+        uint16_t idx = READ_SHORT();
+        Eps_Object *ref = &vm->globals[idx];
+
+        if (!vm->defined[idx]) {
+            RUNTIME_ERROR(
+                "variable '%s' is not defined",
+                vm->program->global_names[idx]
+            );
+        }
+
+        if (ref->type != PEEK(0).type) {
+            RUNTIME_ERROR(
+                "cannot assign '%s' to variable type '%s'",
+                EpsDbg_GetObjectTypeString(PEEK(0).type),
+                EpsDbg_GetObjectTypeString(ref->type)
+            );
+        }
+
+        value_free(*ref);
+        *ref = POP();
+        NEXT();
+    }
+    CASE(OP_CHECK_TYPE)
+    {
+        Eps_ObjectType type = READ_BYTE();
+        Eps_CheckKind kind = READ_BYTE();
+
+        if (PEEK(0).type != type) {
+            RUNTIME_ERROR(
+                "cannot assign value type '%s' to %s type '%s'",
+                EpsDbg_GetObjectTypeString(PEEK(0).type),
+                type_check_strings[kind],
+                EpsDbg_GetObjectTypeString(type)
+            );
+        }
+
+        NEXT();
+    }
+    CASE(OP_ADD)
+    {
+        if (PEEK(0).type == OBJ_REAL && PEEK(1).type == OBJ_REAL) {
+            sp--;
+            sp[-1].real += sp[0].real;
+        } else if (PEEK(0).type == OBJ_STRING && PEEK(1).type == OBJ_STRING) {
+            sp--;
+            sp[-1] = EpsObject_Concat(sp[-1], sp[0]);
+        } else {
+            binary_error(LOC(), OP_ADD, &PEEK(1), &PEEK(0));
+            goto unwind;
+        }
+
+        NEXT();
+    }
+    CASE(OP_SUB)
+    {
+        BINARY_REAL(OP_SUB, OBJ_REAL, real, -);
+        NEXT();
+    }
+    CASE(OP_MUL)
+    {
+        BINARY_REAL(OP_MUL, OBJ_REAL, real, *);
+        NEXT();
+    }
+    CASE(OP_DIV)
+    {
+        BINARY_REAL(OP_DIV, OBJ_REAL, real, /);
+        NEXT();
+    }
+    CASE(OP_EQUAL)
+    {
+        if (PEEK(0).type == OBJ_STRING && PEEK(1).type == OBJ_STRING) {
+            sp--;
+            sp[-1] = compare_strings(sp[-1], sp[0], true);
+        } else {
+            BINARY_REAL(OP_EQUAL, OBJ_BOOL, boolean, ==);
+        }
+
+        NEXT();
+    }
+    CASE(OP_NOT_EQUAL)
+    {
+        if (PEEK(0).type == OBJ_STRING && PEEK(1).type == OBJ_STRING) {
+            sp--;
+            sp[-1] = compare_strings(sp[-1], sp[0], false);
+        } else {
+            BINARY_REAL(OP_NOT_EQUAL, OBJ_BOOL, boolean, !=);
+        }
+
+        NEXT();
+    }
+    CASE(OP_LESS)
+    {
+        BINARY_REAL(OP_LESS, OBJ_BOOL, boolean, <);
+        NEXT();
+    }
+    CASE(OP_LESS_EQUAL)
+    {
+        BINARY_REAL(OP_LESS_EQUAL, OBJ_BOOL, boolean, <=);
+        NEXT();
+    }
+    CASE(OP_GREATER)
+    {
+        BINARY_REAL(OP_GREATER, OBJ_BOOL, boolean, >);
+        NEXT();
+    }
+    CASE(OP_GREATER_EQUAL)
+    {
+        BINARY_REAL(OP_GREATER_EQUAL, OBJ_BOOL, boolean, >=);
+        NEXT();
+    }
+    CASE(OP_NEGATE)
+    {
+        if (PEEK(0).type != OBJ_REAL) {
+            RUNTIME_ERROR(
+                "cannot apply - to expression type %s",
+                EpsDbg_GetObjectTypeString(PEEK(0).type)
+            );
+        }
+
+        sp[-1].real = -sp[-1].real;
+        NEXT();
+    }
+    CASE(OP_TO_STRING)
+    {
+        if (PEEK(0).type == OBJ_VOID) {
+            RUNTIME_ERROR("cannot apply str to expression type void");
+        }
+
+        if (PEEK(0).type != OBJ_STRING) {
+            sp[-1] = EpsObject_ToString(sp[-1]);
+        }
+
+        NEXT();
+    }
+    CASE(OP_JUMP)
+    {
+        uint16_t offset = READ_SHORT();
+
+        ip += offset;
+        NEXT();
+    }
+    CASE(OP_JUMP_IF_FALSE)
+    {
+        uint16_t offset = READ_SHORT();
+
+        if (PEEK(0).type != OBJ_BOOL) {
+            RUNTIME_ERROR(
+                "invalid condition type '%s'",
+                EpsDbg_GetObjectTypeString(PEEK(0).type)
+            );
+        }
+
+        if (!POP().boolean)
+            ip += offset;
+
+        NEXT();
+    }
+    CASE(OP_CALL)
+    {
+        Eps_Function *callee = functions[READ_SHORT()];
+
+        // stacks are moved when they grow
+        if (vm->frame_count == vm->frame_capacity ||
+            sp + callee->max_stack > stack_end) {
+            Eps_Object *moved = grow_stack(vm, sp, callee->max_stack);
+
+            if (moved == NULL) {
+                RUNTIME_ERROR("stack overflow");
+            }
+
+            sp = moved;
+            stack_end = vm->stack + vm->stack_capacity;
+            frame = &vm->frames[vm->frame_count - 1];
+        }
+
+        frame->ip = ip;
+        frame = &vm->frames[vm->frame_count++];
+        frame->func = callee;
+        frame->slots = sp - callee->arity;
+        // top-level functions are defined in the script frame
+        frame->link = callee->level == 1
+            ? 0
+            : defining_frame(vm, vm->frame_count - 2, callee->level);
+
+        ip = callee->chunk.code;
+        slots = frame->slots;
+        constants = callee->chunk.constants;
+        NEXT();
+    }
+    CASE(OP_RETURN)
+    {
+        Eps_Object result;
+
+        if (PEEK(0).type != frame->func->type) {
+            RUNTIME_ERROR(
+                "cannot return '%s' from a function type '%s'",
+                EpsDbg_GetObjectTypeString(PEEK(0).type),
+                EpsDbg_GetObjectTypeString(frame->func->type)
+            );
+        }
+
+        result = POP();
+
+        while (sp > slots)
+            value_free(POP());
+
+        vm->frame_count--;
+        LOAD_FRAME();
+        PUSH(result);
+        NEXT();
+    }
+    CASE(OP_RETURN_VOID)
+    {
+        while (sp > slots)
+            value_free(POP());
+
+        if (--vm->frame_count == 0) {
+            vm->sp = sp;
+            return;
+        }
+
+        LOAD_FRAME();
+        sp->type = OBJ_VOID;
+        sp++;
+        NEXT();
+    }
+    CASE(OP_OUTPUT)
+    {
+        if (PEEK(0).type == OBJ_VOID) {
+            RUNTIME_ERROR("cannot output value type of 'void'");
+        }
+
+        output(PEEK(0));
+        value_free(POP());
+        NEXT();
+    }
+
+#ifndef EPS_COMPUTED_GOTO
+    }
+#endif
+
+unwind:
+    // release values left on the stack by aborted frames
+    while (sp > vm->stack)
+        value_free(POP());
+
+    vm->sp = sp;
+    vm->frame_count = 0;
+
+#undef READ_BYTE
+#undef READ_SHORT
+#undef PUSH
+#undef POP
+#undef PEEK
+#undef LOC
+#undef LOAD_FRAME
+#undef RUNTIME_ERROR
+#undef BINARY_REAL
+#undef DISPATCH
+#undef CASE
+#undef NEXT
+}
+
+void
+EpsVm_Run(Eps_Program *program, size_t max_depth)
+{
+    _DEBUG("------------------- VM -------------------\n");
+
+    VM vm;
+    Eps_Function *script = program->functions[0];
+    size_t i;
+
+    vm.program = program;
+    vm.max_depth = max_depth;
+    vm.frame_capacity = FRAMES_INIT <= max_depth ? FRAMES_INIT : max_depth + 1;
+    vm.frames = EpsMem_Alloc(sizeof(CallFrame)*vm.frame_capacity);
+    vm.stack_capacity = script->max_stack > STACK_INIT
+        ? script->max_stack
+        : STACK_INIT;
+    vm.stack = EpsMem_Alloc(sizeof(Eps_Object)*vm.stack_capacity);
+    vm.globals = EpsMem_Alloc(sizeof(Eps_Object)*(program->global_count + 1));
+    vm.defined = EpsMem_Calloc(sizeof(bool), program->global_count + 1);
+
+    vm.sp = vm.stack;
+    vm.frame_count = 1;
+    vm.frames[0].func = script;
+    vm.frames[0].ip = script->chunk.code;
+    vm.frames[0].slots = vm.stack;
+    vm.frames[0].link = 0;
+
+    run(&vm);
+
+    for (i = 0; i < program->global_count; i++) {
+        if (vm.defined[i])
+            value_free(vm.globals[i]);
+    }
+
+    EpsMem_Free(vm.frames);
+    EpsMem_Free(vm.stack);
+    EpsMem_Free(vm.globals);
+    EpsMem_Free(vm.defined);
+}